@@ -0,0 +1,198 @@
+
+/*
+ * Bright benchmark: times every operation over operand sizes from 1 limb up
+ * to --max-limbs and prints one CSV row per (operation, size):
+ *
+ *     op,limbs,iterations,ns_per_op,limbs_per_s,allocs_per_op
+ *
+ * limbs is the size of the (larger) input, allocs_per_op counts calls to the
+ * global operator new. Build with `make bench`.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <random>
+#include "bright.h"
+
+static unsigned long long allocations = 0;
+
+void *operator new(size_t n)
+{
+    ++allocations;
+    if (void *p = std::malloc(n ? n : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t n)
+{
+    return operator new(n);
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+std::mt19937_64 rng(20240601);
+
+// exactly n limbs, the top one non-zero
+Bright randomLimbs(size_t n)
+{
+    vector<unsigned char> bytes(n * Bright::limb_bits / 8);
+    for (unsigned char &c : bytes)
+        c = static_cast<unsigned char>(rng());
+    bytes.back() |= 0x80;
+    return Bright::fromBytes(bytes.data(), bytes.size(), 1, -1, -1);
+}
+
+// the sizes swept: 1, 2, 5, 10, 20, 50, ... up to max
+vector<size_t> sizes(size_t max)
+{
+    vector<size_t> res;
+    for (size_t p = 1; p <= max; p *= 10) {
+        for (size_t m : { 1, 2, 5 }) {
+            if (p * m <= max)
+                res.push_back(p * m);
+        }
+    }
+    return res;
+}
+
+// an operation on one size; prepare builds the inputs outside the timing,
+// run does one operation and returns something that depends on its result
+struct Op {
+    string name;
+    std::function<void(size_t)> prepare;
+    std::function<size_t()> run;
+};
+
+struct Args {
+    size_t maxLimbs = 1000000;
+    double minTime = 0.2;
+    vector<string> only;
+};
+
+Args parseArgs(int argc, char **argv)
+{
+    Args args;
+    for (int i = 1; i < argc; ++i) {
+        string a = argv[i];
+        if (a == "--max-limbs" && i + 1 < argc) {
+            args.maxLimbs = std::strtoull(argv[++i], nullptr, 10);
+        } else if (a == "--min-time" && i + 1 < argc) {
+            args.minTime = std::strtod(argv[++i], nullptr);
+        } else if (a == "--ops" && i + 1 < argc) {
+            std::stringstream ss(argv[++i]);
+            for (string op; std::getline(ss, op, ','); )
+                args.only.push_back(op);
+        } else {
+            std::cerr << "usage: bench [--max-limbs N] [--min-time SECONDS] [--ops op1,op2,...]\n";
+            std::exit(a == "--help" ? 0 : 1);
+        }
+    }
+    return args;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Args args = parseArgs(argc, argv);
+
+    Bright a, b, big;
+    vector<Bright> many;
+    string text[17];
+    vector<Op> ops = {
+        { "add", [&](size_t n) { a = randomLimbs(n); b = randomLimbs(n); },
+          [&] { return (a + b).size(); } },
+        { "sub", [&](size_t n) { a = randomLimbs(n); b = randomLimbs(n); },
+          [&] { return (a - b).size(); } },
+        { "mul", [&](size_t n) { a = randomLimbs(n); b = randomLimbs(n); },
+          [&] { return (a * b).size(); } },
+        // 2n by n limbs
+        { "div", [&](size_t n) { big = randomLimbs(2 * n); b = randomLimbs(n); },
+          [&] { return (big / b).size(); } },
+        { "mod", [&](size_t n) { big = randomLimbs(2 * n); b = randomLimbs(n); },
+          [&] { return (big % b).size(); } },
+        { "divmod", [&](size_t n) { big = randomLimbs(2 * n); b = randomLimbs(n); },
+          [&] { return divmod(big, b).second.size(); } },
+        { "shl", [&](size_t n) { a = randomLimbs(n); },
+          [&] { return (a << 1234).size(); } },
+        { "shr", [&](size_t n) { a = randomLimbs(n); },
+          [&] { return (a >> 1234).size(); } },
+        // n one-limb values, n one-limb moduli
+        { "product", [&](size_t n) { many.clear(); for (size_t i = 0; i < n; ++i) many.push_back(randomLimbs(1)); },
+          [&] { return product(many).size(); } },
+        { "remtree", [&](size_t n) { a = randomLimbs(n); many.clear(); for (size_t i = 0; i < n; ++i) many.push_back(randomLimbs(1)); },
+          [&] { return remainderTree(a, many).size(); } },
+        // equal down to the lowest limb, the worst case
+        { "cmp", [&](size_t n) { a = randomLimbs(n); b = a + 1; },
+          [&] { return static_cast<size_t>(a < b); } },
+    };
+    for (int base : { 2, 8, 10, 16 }) {
+        string suffix = std::to_string(base);
+        ops.push_back({ "toStr" + suffix, [&](size_t n) { a = randomLimbs(n); },
+                        [&, base] { return a.toStr(base).size(); } });
+        ops.push_back({ "fromStr" + suffix, [&, base](size_t n) { text[base] = randomLimbs(n).toStr(base); },
+                        [&, base] { return Bright::fromStr(text[base], base).size(); } });
+    }
+
+    std::cerr << "kernels " << Bright::simdKernel() << std::endl;
+    std::cout << "op,limbs,iterations,ns_per_op,limbs_per_s,allocs_per_op" << std::endl;
+    size_t sink = 0;
+    for (const Op &op : ops) {
+        if (!args.only.empty() && std::find(args.only.begin(), args.only.end(), op.name) == args.only.end())
+            continue;
+        for (size_t n : sizes(args.maxLimbs)) {
+            op.prepare(n);
+            sink += op.run();
+
+            // doubling batches until one takes min-time
+            size_t iters = 1;
+            double secs = 0;
+            unsigned long long allocs = 0;
+            for (;;) {
+                unsigned long long before = allocations;
+                Clock::time_point start = Clock::now();
+                for (size_t i = 0; i < iters; ++i)
+                    sink += op.run();
+                secs = std::chrono::duration<double>(Clock::now() - start).count();
+                allocs = allocations - before;
+                if (secs >= args.minTime || iters >= (static_cast<size_t>(1) << 40))
+                    break;
+                iters = secs > 0 ? std::max(iters * 2, static_cast<size_t>(iters * args.minTime / secs * 1.2)) : iters * 2;
+            }
+            double ns = secs * 1e9 / static_cast<double>(iters);
+            std::cout << op.name << ',' << n << ',' << iters << ','
+                      << std::fixed << std::setprecision(1) << ns << ','
+                      << std::setprecision(0) << static_cast<double>(n) * 1e9 / ns << ','
+                      << std::setprecision(2) << static_cast<double>(allocs) / static_cast<double>(iters)
+                      << std::defaultfloat << std::endl;
+        }
+    }
+    std::cerr << "checksum " << sink << std::endl;
+    return 0;
+}
@@ -1,570 +1,3357 @@
 #include "bright.h"
 #include <iomanip>
+#include <deque>
+#include <mutex>
+#include <cmath>
+#include <thread>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <exception>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <chrono>
+#include <cstddef>
+#if BRIGHT_SIMD && BRIGHT_LIMB_BITS == 64 && defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #undef BigInt
 
+size_t BigInt::karatsubaThreshold = BRIGHT_KARATSUBA_THRESHOLD;
+size_t BigInt::toom3Threshold = BRIGHT_TOOM3_THRESHOLD;
+size_t BigInt::nttThreshold = BRIGHT_NTT_THRESHOLD;
+size_t BigInt::divThreshold = BRIGHT_DIV_THRESHOLD;
+size_t BigInt::parallelThreshold = BRIGHT_PARALLEL_THRESHOLD;
+unsigned int BigInt::threads = BRIGHT_THREADS;
+
+namespace {
+
+#if BRIGHT_STATS
+// relaxed atomics, pool threads update them too
+struct StatCounters {
+    std::atomic<unsigned long long> calls[BigInt::statOpCount];
+    std::atomic<unsigned long long> limbs[BigInt::statOpCount];
+    std::atomic<unsigned long long> nanoseconds[BigInt::statOpCount];
+    std::atomic<unsigned long long> allocations, frees, bytes, liveBytes, peakBytes;
+} statCounters;
+
+// counts the call when constructed and its time when destroyed
+class StatScope {
+public:
+    StatScope(BigInt::StatOp op, size_t limbs) : op(op), start(std::chrono::steady_clock::now())
+    {
+        statCounters.calls[op].fetch_add(1, std::memory_order_relaxed);
+        statCounters.limbs[op].fetch_add(limbs, std::memory_order_relaxed);
+    }
+
+    // for operations that only know their size at the end
+    void addLimbs(size_t limbs)
+    {
+        statCounters.limbs[op].fetch_add(limbs, std::memory_order_relaxed);
+    }
+
+    ~StatScope()
+    {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        statCounters.nanoseconds[op].fetch_add(static_cast<unsigned long long>(ns.count()), std::memory_order_relaxed);
+    }
+
+private:
+    BigInt::StatOp op;
+    std::chrono::steady_clock::time_point start;
+};
+
+void statAlloc(size_t bytes)
+{
+    statCounters.allocations.fetch_add(1, std::memory_order_relaxed);
+    statCounters.bytes.fetch_add(bytes, std::memory_order_relaxed);
+    unsigned long long live = statCounters.liveBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    unsigned long long peak = statCounters.peakBytes.load(std::memory_order_relaxed);
+    while (live > peak && !statCounters.peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) { }
+}
+
+void statFree(size_t bytes)
+{
+    statCounters.frees.fetch_add(1, std::memory_order_relaxed);
+    statCounters.liveBytes.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+#define BRIGHT_STAT(op, limbs) StatScope statScope(BigInt::op, limbs)
+#define BRIGHT_STAT_LIMBS(limbs) statScope.addLimbs(limbs)
+#define BRIGHT_STAT_ALLOC(limbs) statAlloc((limbs) * sizeof(BigInt::limb_t))
+#define BRIGHT_STAT_FREE(limbs) statFree((limbs) * sizeof(BigInt::limb_t))
+#else
+#define BRIGHT_STAT(op, limbs) ((void) 0)
+#define BRIGHT_STAT_LIMBS(limbs) ((void) 0)
+#define BRIGHT_STAT_ALLOC(limbs) ((void) 0)
+#define BRIGHT_STAT_FREE(limbs) ((void) 0)
+#endif
+
+// heap limb blocks start with a header naming the resource they came from,
+// null for new/delete; it keeps the limbs maximally aligned
+const size_t limbHeader = alignof(std::max_align_t) > sizeof(void *) ? alignof(std::max_align_t) : sizeof(void *);
+thread_local BigInt::MemoryResource *currentResource = nullptr;
+
+BigInt::limb_t *allocLimbs(size_t n)
+{
+    BigInt::MemoryResource *r = currentResource;
+    size_t bytes = limbHeader + n * sizeof(BigInt::limb_t);
+    void *raw = r ? r->allocate(bytes) : ::operator new(bytes);
+    *static_cast<BigInt::MemoryResource **>(raw) = r;
+    return reinterpret_cast<BigInt::limb_t *>(static_cast<char *>(raw) + limbHeader);
+}
+
+void freeLimbs(BigInt::limb_t *p, size_t n)
+{
+    void *raw = reinterpret_cast<char *>(p) - limbHeader;
+    BigInt::MemoryResource *r = *static_cast<BigInt::MemoryResource **>(raw);
+    if (r) r->deallocate(raw, limbHeader + n * sizeof(BigInt::limb_t));
+    else ::operator delete(raw);
+}
+
+// new/delete for the current thread until the end of the scope, for values
+// that may outlive the caller's resource
+class DefaultResource {
+public:
+    DefaultResource() : previous(currentResource)
+    {
+        currentResource = nullptr;
+    }
+
+    DefaultResource(const DefaultResource &) = delete;
+    DefaultResource& operator=(const DefaultResource &) = delete;
+
+    ~DefaultResource()
+    {
+        currentResource = previous;
+    }
+
+private:
+    BigInt::MemoryResource *previous;
+};
+
+const char *const statNames[BigInt::statOpCount] = {
+    "add", "mul", "mulSmall", "divmod", "divSmall", "shift", "bitwise",
+    "powmod", "gcd", "root", "toStr", "fromStr", "trim"
+};
+
+} // namespace
+
+BigInt::limb_vector::limb_vector() : p(buf), n(0), cap(BRIGHT_INLINE_LIMBS)
+{
+
+}
+
+// n zero limbs
+BigInt::limb_vector::limb_vector(size_t m) : p(buf), n(0), cap(BRIGHT_INLINE_LIMBS)
+{
+    resize(m);
+}
+
+BigInt::limb_vector::limb_vector(const limb_vector &o) : p(buf), n(0), cap(BRIGHT_INLINE_LIMBS)
+{
+    *this = o;
+}
+
+// a heap buffer is taken over, an inline one has to be copied
+BigInt::limb_vector::limb_vector(limb_vector &&o) noexcept : p(buf), n(o.n), cap(BRIGHT_INLINE_LIMBS)
+{
+    if (o.isInline()) {
+        std::copy(o.p, o.p + o.n, buf);
+    } else {
+        p = o.p;
+        cap = o.cap;
+        o.p = o.buf;
+        o.cap = BRIGHT_INLINE_LIMBS;
+    }
+    o.n = 0;
+}
+
+BigInt::limb_vector::~limb_vector()
+{
+    if (!isInline()) {
+        BRIGHT_STAT_FREE(cap);
+        freeLimbs(p, cap);
+    }
+}
+
+BigInt::limb_vector &BigInt::limb_vector::operator=(const limb_vector &o)
+{
+    if (this == &o)
+        return *this;
+    n = 0;
+    reserve(o.n);
+    std::copy(o.p, o.p + o.n, p);
+    n = o.n;
+    return *this;
+}
+
+BigInt::limb_vector &BigInt::limb_vector::operator=(limb_vector &&o) noexcept
+{
+    if (this == &o)
+        return *this;
+    if (o.isInline()) {
+        // keeps our own buffer, o.n fits whichever one that is
+        std::copy(o.p, o.p + o.n, p);
+    } else {
+        if (!isInline()) {
+            BRIGHT_STAT_FREE(cap);
+            freeLimbs(p, cap);
+        }
+        p = o.p;
+        cap = o.cap;
+        o.p = o.buf;
+        o.cap = BRIGHT_INLINE_LIMBS;
+    }
+    n = o.n;
+    o.n = 0;
+    return *this;
+}
+
+size_t BigInt::limb_vector::size() const
+{
+    return n;
+}
+
+bool BigInt::limb_vector::empty() const
+{
+    return n == 0;
+}
+
+bool BigInt::limb_vector::isInline() const
+{
+    return p == buf;
+}
+
+BigInt::limb_t *BigInt::limb_vector::data()
+{
+    return p;
+}
+
+const BigInt::limb_t *BigInt::limb_vector::data() const
+{
+    return p;
+}
+
+BigInt::limb_t *BigInt::limb_vector::begin()
+{
+    return p;
+}
+
+BigInt::limb_t *BigInt::limb_vector::end()
+{
+    return p + n;
+}
+
+BigInt::limb_t &BigInt::limb_vector::operator[](size_t i)
+{
+    return p[i];
+}
+
+const BigInt::limb_t &BigInt::limb_vector::operator[](size_t i) const
+{
+    return p[i];
+}
+
+BigInt::limb_t &BigInt::limb_vector::front()
+{
+    return p[0];
+}
+
+BigInt::limb_t &BigInt::limb_vector::back()
+{
+    return p[n - 1];
+}
+
+const BigInt::limb_t &BigInt::limb_vector::back() const
+{
+    return p[n - 1];
+}
+
+// grows geometrically, the contents are kept
+void BigInt::limb_vector::reserve(size_t want)
+{
+    if (want <= cap)
+        return;
+    size_t c = std::max(want, cap * 2);
+    limb_t *q = allocLimbs(c);
+    BRIGHT_STAT_ALLOC(c);
+    std::copy(p, p + n, q);
+    if (!isInline()) {
+        BRIGHT_STAT_FREE(cap);
+        freeLimbs(p, cap);
+    }
+    p = q;
+    cap = c;
+}
+
+void BigInt::limb_vector::resize(size_t m, limb_t value)
+{
+    reserve(m);
+    if (m > n)
+        std::fill(p + n, p + m, value);
+    n = m;
+}
+
+void BigInt::limb_vector::assign(size_t m, limb_t value)
+{
+    n = 0;
+    resize(m, value);
+}
+
+void BigInt::limb_vector::clear()
+{
+    n = 0;
+}
+
+void BigInt::limb_vector::push_back(limb_t x)
+{
+    if (n == cap)
+        reserve(n + 1);
+    p[n++] = x;
+}
+
+void BigInt::limb_vector::pop_back()
+{
+    --n;
+}
+
+BigInt::limb_t *BigInt::limb_vector::insert(limb_t *pos, size_t count, limb_t value)
+{
+    size_t at = static_cast<size_t>(pos - p);
+    reserve(n + count);
+    std::copy_backward(p + at, p + n, p + n + count);
+    std::fill(p + at, p + at + count, value);
+    n += count;
+    return p + at;
+}
+
+BigInt::limb_t *BigInt::limb_vector::insert(limb_t *pos, limb_t value)
+{
+    return insert(pos, 1, value);
+}
+
+BigInt::limb_t *BigInt::limb_vector::erase(limb_t *first, limb_t *last)
+{
+    std::copy(last, p + n, first);
+    n -= static_cast<size_t>(last - first);
+    return first;
+}
+
+namespace {
+
+// raw limb kernels, little-endian arrays of full-width limbs
+typedef BigInt::limb_t limb_t;
+#if BRIGHT_LIMB_BITS == 64
+typedef unsigned __int128 dlimb_t;
+typedef __int128 sdlimb_t;
+#else
+typedef unsigned long long dlimb_t;
+typedef long long sdlimb_t;
+#endif
+
+const unsigned int limbBits = BigInt::limb_bits;
+
+int cmpLimbs(const limb_t *a, size_t an, const limb_t *b, size_t bn)
+{
+    while (an > bn) if (a[--an]) return 1;
+    while (bn > an) if (b[--bn]) return -1;
+    for (size_t i = an - 1; i < an; --i) {
+        if (a[i] != b[i])
+            return a[i] < b[i] ? -1 : 1;
+    }
+    return 0;
+}
+
+// r = a + b + carry over n limbs each, returns the carry out
+limb_t addN(limb_t *r, const limb_t *a, const limb_t *b, size_t n, limb_t carry)
+{
+    for (size_t i = 0; i < n; ++i) {
+        dlimb_t t = static_cast<dlimb_t>(a[i]) + b[i] + carry;
+        r[i] = static_cast<limb_t>(t);
+        carry = static_cast<limb_t>(t >> limbBits);
+    }
+    return carry;
+}
+
+// r = a - b - borrow over n limbs each, returns the borrow out
+limb_t subN(limb_t *r, const limb_t *a, const limb_t *b, size_t n, limb_t borrow)
+{
+    for (size_t i = 0; i < n; ++i) {
+        limb_t x = a[i], y = b[i];
+        r[i] = x - y - borrow;
+        borrow = x < y || (borrow && x == y);
+    }
+    return borrow;
+}
+
+#if BRIGHT_SIMD && BRIGHT_LIMB_BITS == 64 && defined(__x86_64__) && defined(__GNUC__)
+#define BRIGHT_X86_SIMD 1
+
+// The vector kernels add whole lanes first and settle the carries per block
+// afterwards: g has a bit for each lane that wrapped, p for each lane that
+// passes an incoming carry on (all ones for add, zero for sub). Adding p to
+// the shifted g ripples the carries through the block in one scalar add,
+// c ^ p then marks the lanes that take a carry in.
+
+// the lanes of a 4-bit carry mask as 0/1 limbs
+alignas(32) const limb_t carryLanes[16][4] = {
+    { 0, 0, 0, 0 }, { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 1, 1, 0, 0 },
+    { 0, 0, 1, 0 }, { 1, 0, 1, 0 }, { 0, 1, 1, 0 }, { 1, 1, 1, 0 },
+    { 0, 0, 0, 1 }, { 1, 0, 0, 1 }, { 0, 1, 0, 1 }, { 1, 1, 0, 1 },
+    { 0, 0, 1, 1 }, { 1, 0, 1, 1 }, { 0, 1, 1, 1 }, { 1, 1, 1, 1 },
+};
+
+__attribute__((target("avx2")))
+limb_t addNAvx2(limb_t *r, const limb_t *a, const limb_t *b, size_t n, limb_t carry)
+{
+    const __m256i sign = _mm256_set1_epi64x(static_cast<long long>(1ULL << 63));
+    const __m256i ones = _mm256_set1_epi64x(-1);
+    unsigned int c = static_cast<unsigned int>(carry);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+        __m256i s = _mm256_add_epi64(x, y);
+        // AVX2 only compares signed, flip the sign bits for s < x
+        __m256i gv = _mm256_cmpgt_epi64(_mm256_xor_si256(x, sign), _mm256_xor_si256(s, sign));
+        __m256i pv = _mm256_cmpeq_epi64(s, ones);
+        unsigned int g = static_cast<unsigned int>(_mm256_movemask_pd(_mm256_castsi256_pd(gv)));
+        unsigned int p = static_cast<unsigned int>(_mm256_movemask_pd(_mm256_castsi256_pd(pv)));
+        c = ((g << 1) | c) + p;
+        __m256i cv = _mm256_load_si256(reinterpret_cast<const __m256i *>(carryLanes[(c ^ p) & 15]));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(r + i), _mm256_add_epi64(s, cv));
+        c >>= 4;
+    }
+    return addN(r + i, a + i, b + i, n - i, c);
+}
+
+__attribute__((target("avx2")))
+limb_t subNAvx2(limb_t *r, const limb_t *a, const limb_t *b, size_t n, limb_t borrow)
+{
+    const __m256i sign = _mm256_set1_epi64x(static_cast<long long>(1ULL << 63));
+    const __m256i zero = _mm256_setzero_si256();
+    unsigned int c = static_cast<unsigned int>(borrow);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+        __m256i d = _mm256_sub_epi64(x, y);
+        __m256i gv = _mm256_cmpgt_epi64(_mm256_xor_si256(y, sign), _mm256_xor_si256(x, sign));
+        __m256i pv = _mm256_cmpeq_epi64(d, zero);
+        unsigned int g = static_cast<unsigned int>(_mm256_movemask_pd(_mm256_castsi256_pd(gv)));
+        unsigned int p = static_cast<unsigned int>(_mm256_movemask_pd(_mm256_castsi256_pd(pv)));
+        c = ((g << 1) | c) + p;
+        __m256i cv = _mm256_load_si256(reinterpret_cast<const __m256i *>(carryLanes[(c ^ p) & 15]));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(r + i), _mm256_sub_epi64(d, cv));
+        c >>= 4;
+    }
+    return subN(r + i, a + i, b + i, n - i, c);
+}
+
+// AVX-512 has unsigned compares into mask registers and masked adds, no table
+__attribute__((target("avx512f")))
+limb_t addNAvx512(limb_t *r, const limb_t *a, const limb_t *b, size_t n, limb_t carry)
+{
+    const __m512i one = _mm512_set1_epi64(1);
+    const __m512i ones = _mm512_set1_epi64(-1);
+    unsigned int c = static_cast<unsigned int>(carry);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m512i x = _mm512_loadu_si512(a + i);
+        __m512i y = _mm512_loadu_si512(b + i);
+        __m512i s = _mm512_add_epi64(x, y);
+        unsigned int g = _mm512_cmplt_epu64_mask(s, x);
+        unsigned int p = _mm512_cmpeq_epu64_mask(s, ones);
+        c = ((g << 1) | c) + p;
+        _mm512_storeu_si512(r + i, _mm512_mask_add_epi64(s, static_cast<__mmask8>(c ^ p), s, one));
+        c >>= 8;
+    }
+    return addN(r + i, a + i, b + i, n - i, c);
+}
+
+__attribute__((target("avx512f")))
+limb_t subNAvx512(limb_t *r, const limb_t *a, const limb_t *b, size_t n, limb_t borrow)
+{
+    const __m512i one = _mm512_set1_epi64(1);
+    const __m512i zero = _mm512_setzero_si512();
+    unsigned int c = static_cast<unsigned int>(borrow);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m512i x = _mm512_loadu_si512(a + i);
+        __m512i y = _mm512_loadu_si512(b + i);
+        __m512i d = _mm512_sub_epi64(x, y);
+        unsigned int g = _mm512_cmplt_epu64_mask(x, y);
+        unsigned int p = _mm512_cmpeq_epu64_mask(d, zero);
+        c = ((g << 1) | c) + p;
+        _mm512_storeu_si512(r + i, _mm512_mask_sub_epi64(d, static_cast<__mmask8>(c ^ p), d, one));
+        c >>= 8;
+    }
+    return subN(r + i, a + i, b + i, n - i, c);
+}
+#endif
+
+// the add/sub kernels for this CPU, chosen once on first use
+struct CarryKernels {
+    limb_t (*add)(limb_t *, const limb_t *, const limb_t *, size_t, limb_t);
+    limb_t (*sub)(limb_t *, const limb_t *, const limb_t *, size_t, limb_t);
+    const char *name;
+};
+
+CarryKernels pickCarryKernels()
+{
+#ifdef BRIGHT_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return { addNAvx512, subNAvx512, "avx512" };
+    if (__builtin_cpu_supports("avx2"))
+        return { addNAvx2, subNAvx2, "avx2" };
+#endif
+    return { addN, subN, "scalar" };
+}
+
+const CarryKernels &carryKernels()
+{
+    static const CarryKernels kernels = pickCarryKernels();
+    return kernels;
+}
+
+// below this many limbs the vector setup costs more than it saves
+const size_t simdMinLimbs = 8;
+
+// r = a + b, an >= bn, r has an limbs, returns carry
+limb_t addLimbs(limb_t *r, const limb_t *a, size_t an, const limb_t *b, size_t bn)
+{
+    limb_t carry = bn < simdMinLimbs ? addN(r, a, b, bn, 0) : carryKernels().add(r, a, b, bn, 0);
+    for (size_t i = bn; i < an; ++i) {
+        limb_t t = a[i] + carry;
+        carry = t < carry;
+        r[i] = t;
+    }
+    return carry;
+}
+
+// r = a - b, a >= b, an >= bn, r has an limbs, returns borrow
+limb_t subLimbs(limb_t *r, const limb_t *a, size_t an, const limb_t *b, size_t bn)
+{
+    limb_t borrow = bn < simdMinLimbs ? subN(r, a, b, bn, 0) : carryKernels().sub(r, a, b, bn, 0);
+    for (size_t i = bn; i < an; ++i) {
+        limb_t x = a[i];
+        r[i] = x - borrow;
+        borrow = x < borrow;
+    }
+    return borrow;
+}
+
+// r[0, n) += a[0, n) * m, returns the carry limb
+limb_t addMul1(limb_t *r, const limb_t *a, size_t n, limb_t m)
+{
+    limb_t carry = 0;
+    for (size_t i = 0; i < n; ++i) {
+        dlimb_t t = static_cast<dlimb_t>(a[i]) * m + r[i] + carry;
+        r[i] = static_cast<limb_t>(t);
+        carry = static_cast<limb_t>(t >> limbBits);
+    }
+    return carry;
+}
+
+// r[0, n) = a[0, n) * m + carry, returns the carry limb
+limb_t mul1(limb_t *r, const limb_t *a, size_t n, limb_t m, limb_t carry = 0)
+{
+    for (size_t i = 0; i < n; ++i) {
+        dlimb_t t = static_cast<dlimb_t>(a[i]) * m + carry;
+        r[i] = static_cast<limb_t>(t);
+        carry = static_cast<limb_t>(t >> limbBits);
+    }
+    return carry;
+}
+
+// r[0, n) = a[0, n) << s, 0 < s < limbBits, returns the bits shifted out
+limb_t shlLimbs(limb_t *r, const limb_t *a, size_t n, unsigned int s)
+{
+    limb_t out = 0;
+    for (size_t i = 0; i < n; ++i) {
+        limb_t t = a[i];
+        r[i] = (t << s) | out;
+        out = t >> (limbBits - s);
+    }
+    return out;
+}
+
+// r[0, n) = a[0, n) >> s, 0 < s < limbBits
+void shrLimbs(limb_t *r, const limb_t *a, size_t n, unsigned int s)
+{
+    for (size_t i = 0; i + 1 < n; ++i)
+        r[i] = (a[i] >> s) | (a[i + 1] << (limbBits - s));
+    if (n)
+        r[n - 1] = a[n - 1] >> s;
+}
+
+// q[0, n) = a[0, n) / d, returns the remainder; q may be a
+limb_t divRem1(limb_t *q, const limb_t *a, size_t n, limb_t d)
+{
+    limb_t rem = 0;
+    for (size_t i = n - 1; i < n; --i) {
+        dlimb_t cur = (static_cast<dlimb_t>(rem) << limbBits) | a[i];
+        q[i] = static_cast<limb_t>(cur / d);
+        rem = static_cast<limb_t>(cur % d);
+    }
+    return rem;
+}
+
+// Knuth's Algorithm D. u[0, un + 1) is the dividend shifted so that the top
+// limb of d[0, dn) has its high bit set, dn >= 2 and un >= dn. Writes
+// q[0, un - dn + 1) and leaves the (still shifted) remainder in u[0, dn)
+void divLimbs(limb_t *q, limb_t *u, size_t un, const limb_t *d, size_t dn)
+{
+    const dlimb_t b = static_cast<dlimb_t>(1) << limbBits;
+    limb_t d1 = d[dn - 1], d0 = d[dn - 2];
+    for (size_t j = un - dn; j <= un - dn; --j) {
+        // estimate from the top two limbs, the third makes it at most one too big
+        dlimb_t num = (static_cast<dlimb_t>(u[j + dn]) << limbBits) | u[j + dn - 1];
+        dlimb_t qhat = num / d1, rhat = num % d1;
+        while (qhat >= b || qhat * d0 > ((rhat << limbBits) | u[j + dn - 2])) {
+            --qhat;
+            rhat += d1;
+            if (rhat >= b) break;
+        }
+
+        // u[j, j + dn] -= qhat * d in place
+        limb_t qj = static_cast<limb_t>(qhat), carry = 0, borrow = 0;
+        for (size_t i = 0; i < dn; ++i) {
+            dlimb_t p = static_cast<dlimb_t>(qj) * d[i] + carry;
+            carry = static_cast<limb_t>(p >> limbBits);
+            limb_t x = u[i + j], y = static_cast<limb_t>(p);
+            limb_t t = x - y;
+            limb_t nb = x < y;
+            nb += t < borrow;
+            u[i + j] = t - borrow;
+            borrow = nb;
+        }
+        dlimb_t sub = static_cast<dlimb_t>(carry) + borrow;
+        limb_t top = u[j + dn];
+        u[j + dn] = top - static_cast<limb_t>(sub);
+
+        // rare: qhat was still one too big, add d back
+        if (top < sub) {
+            --qj;
+            u[j + dn] += addLimbs(u + j, u + j, dn, d, dn);
+        }
+        q[j] = qj;
+    }
+}
+
+// single-limb bit counts, compiler builtins where there are some
+unsigned int bitLength(limb_t x)
+{
+#ifdef __GNUC__
+    return x ? 64 - static_cast<unsigned int>(__builtin_clzll(x)) : 0;
+#else
+    unsigned int b = 0;
+    for (; x; x >>= 1)
+        ++b;
+    return b;
+#endif
+}
+
+unsigned int popcountLimb(limb_t x)
+{
+#ifdef __GNUC__
+    return static_cast<unsigned int>(__builtin_popcountll(x));
+#else
+    unsigned int b = 0;
+    for (; x; x &= x - 1)
+        ++b;
+    return b;
+#endif
+}
+
+// x != 0
+unsigned int ctzLimb(limb_t x)
+{
+#ifdef __GNUC__
+    return static_cast<unsigned int>(__builtin_ctzll(x));
+#else
+    unsigned int b = 0;
+    for (; !(x & 1); x >>= 1)
+        ++b;
+    return b;
+#endif
+}
+
+// r[0, an + bn) = a * b
+void mulBasecase(limb_t *r, const limb_t *a, size_t an, const limb_t *b, size_t bn)
+{
+    std::fill(r, r + an + bn, 0);
+    for (size_t j = 0; j < bn; ++j)
+        r[j + an] = addMul1(r + j, a, an, b[j]);
+}
+
+size_t kThreshold()
+{
+    return std::max<size_t>(BigInt::karatsubaThreshold, 4);
+}
+
+// scratch limbs needed by mulKaratsuba for an x bn
+size_t karatsubaScratch(size_t an, size_t bn)
+{
+    if (bn < kThreshold())
+        return 0;
+    if (bn <= (an + 1) / 2)
+        return 2 * bn + std::max(karatsubaScratch(bn, bn), karatsubaScratch(bn, an % bn));
+    size_t h = (an + 1) / 2;
+    size_t hi = karatsubaScratch(an - h, bn - h);
+    return std::max(hi, 6 * h + 1 + karatsubaScratch(h, h));
+}
+
+// r[0, an + bn) = a * b, an >= bn >= 1, r must not overlap a or b
+void mulKaratsuba(limb_t *r, const limb_t *a, size_t an, const limb_t *b, size_t bn, limb_t *scratch)
+{
+    if (bn < kThreshold()) {
+        mulBasecase(r, a, an, b, bn);
+        return;
+    }
+
+    if (bn <= (an + 1) / 2) {
+        // unbalanced, multiply bn-sized chunks of a
+        std::fill(r, r + an + bn, 0);
+        limb_t *t = scratch;
+        for (size_t i = 0; i < an; i += bn) {
+            size_t len = std::min(bn, an - i);
+            if (len >= bn)
+                mulKaratsuba(t, a + i, len, b, bn, scratch + 2 * bn);
+            else
+                mulKaratsuba(t, b, bn, a + i, len, scratch + 2 * bn);
+            addLimbs(r + i, r + i, an + bn - i, t, len + bn);
+        }
+        return;
+    }
+
+    // karatsuba: a = a1 * B^h + a0, b = b1 * B^h + b0
+    size_t h = (an + 1) / 2;
+    const limb_t *a0 = a, *a1 = a + h, *b0 = b, *b1 = b + h;
+    size_t an1 = an - h, bn1 = bn - h;
+
+    mulKaratsuba(r, a0, h, b0, h, scratch);
+    if (an1 >= bn1)
+        mulKaratsuba(r + 2 * h, a1, an1, b1, bn1, scratch);
+    else
+        mulKaratsuba(r + 2 * h, b1, bn1, a1, an1, scratch);
+
+    limb_t *da = scratch, *db = da + h, *prod = db + h, *mid = prod + 2 * h;
+    int sa = cmpLimbs(a0, h, a1, an1), sb = cmpLimbs(b1, bn1, b0, h);
+    // the smaller half fits in the length of the shorter one
+    if (sa >= 0) subLimbs(da, a0, h, a1, an1);
+    else {
+        std::fill(da + an1, da + h, 0);
+        subLimbs(da, a1, an1, a0, an1);
+    }
+    if (sb >= 0) {
+        std::fill(db + bn1, db + h, 0);
+        subLimbs(db, b1, bn1, b0, bn1);
+    }
+    else subLimbs(db, b0, h, b1, bn1);
+    mulKaratsuba(prod, da, h, db, h, mid + 2 * h + 1);
+
+    // mid = z0 + z2 +- |a0 - a1| * |b1 - b0|
+    mid[2 * h] = addLimbs(mid, r, 2 * h, r + 2 * h, an + bn - 2 * h);
+    if ((sa < 0) == (sb < 0))
+        addLimbs(mid, mid, 2 * h + 1, prod, 2 * h);
+    else
+        subLimbs(mid, mid, 2 * h + 1, prod, 2 * h);
+
+    size_t len = std::min(2 * h + 1, an + bn - h);
+    addLimbs(r + h, r + h, an + bn - h, mid, len);
+}
+
+// one task queue shared by all parallel work. Threads waiting on a group run
+// queued tasks rather than sleep, so groups nest without starving the pool
+class TaskPool {
+public:
+    static TaskPool &instance()
+    {
+        static TaskPool pool;
+        return pool;
+    }
+
+    ~TaskPool()
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stop = true;
+        }
+        wake.notify_all();
+        for (std::thread &t : workers)
+            t.join();
+    }
+
+    void push(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            // workers are started on demand, BigInt::threads counts the caller
+            size_t want = BigInt::threads ? BigInt::threads : std::thread::hardware_concurrency();
+            while (workers.size() + 1 < want)
+                workers.emplace_back(&TaskPool::work, this);
+            tasks.push_back(std::move(task));
+        }
+        wake.notify_one();
+        done.notify_all();
+    }
+
+    // runs the newest queued task, false when there is none
+    bool runOne()
+    {
+        std::function<void()> task;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (tasks.empty())
+                return false;
+            task = std::move(tasks.back());
+            tasks.pop_back();
+        }
+        // the task may belong to another thread's group, keep this thread's
+        // resource out of it just as on the workers
+        DefaultResource scope;
+        task();
+        return true;
+    }
+
+    // blocks until pending drops to zero or there is a task to help with
+    void waitFor(const std::atomic<size_t> &pending)
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        done.wait(guard, [&] { return pending == 0 || !tasks.empty(); });
+    }
+
+    void finished(std::atomic<size_t> &pending)
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            --pending;
+        }
+        done.notify_all();
+    }
+
+private:
+    TaskPool() : stop(false)
+    {
+
+    }
+
+    // workers take the oldest task, usually the largest
+    void work()
+    {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                wake.wait(guard, [&] { return stop || !tasks.empty(); });
+                if (tasks.empty())
+                    return;
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::mutex lock;
+    std::condition_variable wake, done;
+    std::deque<std::function<void()>> tasks;
+    vector<std::thread> workers;
+    bool stop;
+};
+
+// tasks that run on the pool when the group is parallel and inline otherwise;
+// wait() rethrows the first exception a task threw
+class TaskGroup {
+public:
+    explicit TaskGroup(bool parallel) : parallel(parallel), pending(0)
+    {
+
+    }
+
+    ~TaskGroup()
+    {
+        join();
+    }
+
+    template <class F>
+    void run(F f)
+    {
+        if (!parallel) {
+            f();
+            return;
+        }
+        ++pending;
+        TaskPool::instance().push([this, f] {
+            try {
+                f();
+            } catch (...) {
+                std::lock_guard<std::mutex> guard(errorLock);
+                if (!error) error = std::current_exception();
+            }
+            TaskPool::instance().finished(pending);
+        });
+    }
+
+    void wait()
+    {
+        join();
+        if (error) {
+            std::exception_ptr e = error;
+            error = nullptr;
+            std::rethrow_exception(e);
+        }
+    }
+
+private:
+    void join()
+    {
+        TaskPool &pool = TaskPool::instance();
+        while (pending) {
+            if (!pool.runOne())
+                pool.waitFor(pending);
+        }
+    }
+
+    bool parallel;
+    std::atomic<size_t> pending;
+    std::mutex errorLock;
+    std::exception_ptr error;
+};
+
+// work on n limbs is split across threads
+inline bool parallelFor(size_t n)
+{
+    return BigInt::threads != 1 && n >= BigInt::parallelThreshold;
+}
+
+void mulLimbs(limb_t *r, const limb_t *a, size_t an, const limb_t *b, size_t bn);
+
+size_t normLen(const limb_t *x, size_t n)
+{
+    while (n && !x[n - 1]) --n;
+    return n;
+}
+
+// toom-3 keeps its signed intermediates in two's complement of a fixed width
+bool isNeg(const limb_t *x, size_t n)
+{
+    return (x[n - 1] >> (limbBits - 1)) & 1;
+}
+
+void negLimbs(limb_t *x, size_t n)
+{
+    limb_t carry = 1;
+    for (size_t i = 0; i < n; ++i) {
+        x[i] = ~x[i] + carry;
+        carry = carry && x[i] == 0;
+    }
+}
+
+void halveSigned(limb_t *x, size_t n)
+{
+    limb_t top = x[n - 1] & (static_cast<limb_t>(1) << (limbBits - 1));
+    for (size_t i = 0; i + 1 < n; ++i)
+        x[i] = (x[i] >> 1) | ((x[i + 1] & 1) << (limbBits - 1));
+    x[n - 1] = (x[n - 1] >> 1) | top;
+}
+
+void divExact3Signed(limb_t *x, size_t n)
+{
+    bool neg = isNeg(x, n);
+    if (neg) negLimbs(x, n);
+    dlimb_t rem = 0;
+    for (size_t i = n - 1; i < n; --i) {
+        dlimb_t cur = (rem << limbBits) | x[i];
+        x[i] = static_cast<limb_t>(cur / 3);
+        rem = cur % 3;
+    }
+    if (neg) negLimbs(x, n);
+}
+
+// evaluates x0 + x1 * t + x2 * t^2 at t = 1, -1, -2, each e limbs wide
+void toom3Eval(limb_t *p1, limb_t *pm1, limb_t *pm2, size_t e,
+               const limb_t *x0, size_t n0, const limb_t *x1, size_t n1, const limb_t *x2, size_t n2)
+{
+    std::fill(pm1, pm1 + e, 0);
+    std::copy(x0, x0 + n0, pm1);
+    addLimbs(pm1, pm1, e, x2, n2);
+    addLimbs(p1, pm1, e, x1, n1);
+    subLimbs(pm1, pm1, e, x1, n1);
+    addLimbs(pm2, pm1, e, x2, n2);
+    addLimbs(pm2, pm2, e, pm2, e);
+    subLimbs(pm2, pm2, e, x0, n0);
+}
+
+// r[0, w) = x * y for signed e-limb x and y, w >= 2e
+void toom3MulPoint(limb_t *r, size_t w, const limb_t *x, const limb_t *y, size_t e, limb_t *tmp)
+{
+    bool nx = isNeg(x, e), ny = isNeg(y, e);
+    limb_t *mx = tmp, *my = tmp + e;
+    std::copy(x, x + e, mx);
+    std::copy(y, y + e, my);
+    if (nx) negLimbs(mx, e);
+    if (ny) negLimbs(my, e);
+    size_t xn = normLen(mx, e), yn = normLen(my, e);
+    std::fill(r + xn + yn, r + w, 0);
+    mulLimbs(r, mx, xn, my, yn);
+    if (nx != ny) negLimbs(r, w);
+}
+
+// toom-3 with points 0, 1, -1, -2, inf and bodrato's interpolation sequence,
+// an >= bn > an / 2
+void mulToom3(limb_t *r, const limb_t *a, size_t an, const limb_t *b, size_t bn)
+{
+    size_t k = (an + 2) / 3;
+    size_t an2 = an - 2 * k;
+    size_t bn1 = std::min(k, bn - k), bn2 = bn - k - bn1;
+    size_t e = k + 2, w = 2 * e;
+
+    vector<limb_t> buf(12 * e + 4 * w);
+    limb_t *p1 = buf.data(), *pm1 = p1 + e, *pm2 = pm1 + e;
+    limb_t *q1 = pm2 + e, *qm1 = q1 + e, *qm2 = qm1 + e, *tmp = qm2 + e;
+    limb_t *r1 = tmp + 6 * e, *rm1 = r1 + w, *rm2 = rm1 + w, *rinf = rm2 + w;
+
+    toom3Eval(p1, pm1, pm2, e, a, k, a + k, k, a + 2 * k, an2);
+    toom3Eval(q1, qm1, qm2, e, b, k, b + k, bn1, b + 2 * k, bn2);
+
+    // the five point products are independent, each has its own scratch
+    TaskGroup group(parallelFor(bn));
+    group.run([=] { toom3MulPoint(r1, w, p1, q1, e, tmp); });
+    group.run([=] { toom3MulPoint(rm1, w, pm1, qm1, e, tmp + 2 * e); });
+    group.run([=] { toom3MulPoint(rm2, w, pm2, qm2, e, tmp + 4 * e); });
+    group.run([=] {
+        std::fill(r, r + an + bn, 0);
+        mulLimbs(r, a, k, b, k);
+    });
+    size_t rinfn = bn2 ? an2 + bn2 : 0;
+    mulLimbs(rinf, a + 2 * k, an2, b + 2 * k, bn2);
+    group.wait();
+
+    // r0 stays in r[0, 2k), rm1 becomes r2 and rm2 becomes r3
+    subLimbs(rm2, rm2, w, r1, w);
+    divExact3Signed(rm2, w);
+    subLimbs(r1, r1, w, rm1, w);
+    halveSigned(r1, w);
+    subLimbs(rm1, rm1, w, r, 2 * k);
+    subLimbs(rm2, rm1, w, rm2, w);
+    halveSigned(rm2, w);
+    addLimbs(rm2, rm2, w, rinf, rinfn);
+    addLimbs(rm2, rm2, w, rinf, rinfn);
+    addLimbs(rm1, rm1, w, r1, w);
+    subLimbs(rm1, rm1, w, rinf, rinfn);
+    subLimbs(r1, r1, w, rm2, w);
+
+    size_t n = an + bn;
+    std::copy(rinf, rinf + rinfn, r + 4 * k);
+    const limb_t *coef[] = { r1, rm1, rm2 };
+    for (size_t i = 0; i < 3; ++i) {
+        size_t off = (i + 1) * k;
+        size_t len = normLen(coef[i], w);
+        addLimbs(r + off, r + off, n - off, coef[i], len);
+    }
+}
+
+// number theoretic transform over three primes below 2^31. limbs are cut into
+// 32-bit digits, so every coefficient of the convolution is below n * 2^64,
+// and the product of the primes (> 2^90) recovers it exactly through crt for
+// n up to 2^26.
+struct NttPrime {
+    unsigned int p, g, pinv, r2;
+
+    NttPrime(unsigned int p, unsigned int g) : p(p), g(g), pinv(1), r2(0)
+    {
+        // -p^-1 mod 2^32 by newton iteration, R^2 mod p
+        for (int i = 0; i < 5; ++i)
+            pinv *= 2 - p * pinv;
+        pinv = 0u - pinv;
+        unsigned long long r = (1ull << 32) % p;
+        r2 = static_cast<unsigned int>(r * r % p);
+    }
+
+    // montgomery reduction with R = 2^32, t < p * 2^32
+    unsigned int reduce(unsigned long long t) const
+    {
+        unsigned int m = static_cast<unsigned int>(t) * pinv;
+        unsigned int u = static_cast<unsigned int>((t + static_cast<unsigned long long>(m) * p) >> 32);
+        return u >= p ? u - p : u;
+    }
+
+    unsigned int mul(unsigned int a, unsigned int b) const
+    {
+        return reduce(static_cast<unsigned long long>(a) * b);
+    }
+
+    unsigned int toMont(unsigned int a) const { return mul(a % p, r2); }
+    unsigned int fromMont(unsigned int a) const { return reduce(a); }
+
+    unsigned int pow(unsigned int a, unsigned long long e) const
+    {
+        unsigned int res = toMont(1);
+        for (; e; e >>= 1, a = mul(a, a))
+            if (e & 1) res = mul(res, a);
+        return res;
+    }
+
+    unsigned int add(unsigned int a, unsigned int b) const
+    {
+        unsigned int s = a + b;
+        return s >= p ? s - p : s;
+    }
+
+    unsigned int sub(unsigned int a, unsigned int b) const
+    {
+        return a >= b ? a - b : a + p - b;
+    }
+
+    // in-place decimation in frequency, natural order in, bit-reversed out
+    void forward(unsigned int *a, size_t n) const
+    {
+        vector<unsigned int> w(n / 2);
+        for (size_t len = n / 2; len >= 1; len >>= 1) {
+            twiddles(w.data(), len, (p - 1) / (2 * len), false);
+            for (size_t i = 0; i < n; i += 2 * len) {
+                for (size_t j = 0; j < len; ++j) {
+                    unsigned int u = a[i + j], v = a[i + j + len];
+                    a[i + j] = add(u, v);
+                    a[i + j + len] = mul(sub(u, v), w[j]);
+                }
+            }
+        }
+    }
+
+    // in-place decimation in time, bit-reversed in, natural order out,
+    // scaled by 1/n and converted back out of montgomery form
+    void inverse(unsigned int *a, size_t n) const
+    {
+        vector<unsigned int> w(n / 2);
+        for (size_t len = 1; len < n; len <<= 1) {
+            twiddles(w.data(), len, (p - 1) / (2 * len), true);
+            for (size_t i = 0; i < n; i += 2 * len) {
+                for (size_t j = 0; j < len; ++j) {
+                    unsigned int u = a[i + j], v = mul(a[i + j + len], w[j]);
+                    a[i + j] = add(u, v);
+                    a[i + j + len] = sub(u, v);
+                }
+            }
+        }
+        unsigned int ninv = fromMont(pow(toMont(static_cast<unsigned int>(n % p)), p - 2));
+        for (size_t i = 0; i < n; ++i)
+            a[i] = mul(a[i], ninv);
+    }
+
+    void twiddles(unsigned int *w, size_t len, unsigned long long e, bool inv) const
+    {
+        unsigned int root = pow(toMont(g), inv ? (p - 1) - e : e);
+        w[0] = toMont(1);
+        for (size_t j = 1; j < len; ++j)
+            w[j] = mul(w[j - 1], root);
+    }
+};
+
+// transform length limit in 32-bit digits, the primes have 2^26-th roots of
+// unity and the CRT bound leaves no room for longer products either
+const size_t nttMaxLength = static_cast<size_t>(1) << 26;
+const size_t nttDigitsPerLimb = BigInt::limb_bits / 32;
+
+inline unsigned int nttDigit(const limb_t *x, size_t j)
+{
+    return static_cast<unsigned int>(x[j / nttDigitsPerLimb] >> (32 * (j % nttDigitsPerLimb)));
+}
+
+// r[0, an + bn) = a * b through the three-prime ntt
+void mulNtt(limb_t *r, const limb_t *a, size_t an, const limb_t *b, size_t bn)
+{
+    static const NttPrime primes[3] = {
+        NttPrime(2013265921u, 31), NttPrime(1811939329u, 13), NttPrime(469762049u, 3)
+    };
+    size_t ad = an * nttDigitsPerLimb, bd = bn * nttDigitsPerLimb, rd = ad + bd;
+    size_t n = 1;
+    while (n < rd) n <<= 1;
+    bool square = a == b && an == bn;
+
+    // the three primes are independent
+    vector<unsigned int> res[3];
+    TaskGroup group(parallelFor(bn));
+    for (int k = 0; k < 3; ++k) {
+        group.run([&, k] {
+            const NttPrime &P = primes[k];
+            vector<unsigned int> &fa = res[k], fb(square ? 0 : n);
+            fa.assign(n, 0);
+            for (size_t i = 0; i < ad; ++i)
+                fa[i] = P.toMont(nttDigit(a, i));
+            P.forward(fa.data(), n);
+            if (square) {
+                for (size_t i = 0; i < n; ++i)
+                    fa[i] = P.mul(fa[i], fa[i]);
+            }
+            else {
+                std::fill(fb.begin(), fb.end(), 0);
+                for (size_t i = 0; i < bd; ++i)
+                    fb[i] = P.toMont(nttDigit(b, i));
+                P.forward(fb.data(), n);
+                for (size_t i = 0; i < n; ++i)
+                    fa[i] = P.mul(fa[i], fb[i]);
+            }
+            P.inverse(fa.data(), n);
+        });
+    }
+    group.wait();
+
+    // garner: x = x0 + x1 * p0 + x2 * p0 * p1, spread over three 32-bit digits
+    const unsigned long long lo32 = 0xffffffffull;
+    unsigned long long p0 = primes[0].p, p1 = primes[1].p, p2 = primes[2].p, p01 = p0 * p1;
+    unsigned long long inv01 = primes[1].fromMont(primes[1].pow(primes[1].toMont(static_cast<unsigned int>(p0 % p1)), p1 - 2));
+    unsigned long long inv012 = primes[2].fromMont(primes[2].pow(primes[2].toMont(static_cast<unsigned int>(p01 % p2)), p2 - 2));
+
+    vector<unsigned long long> acc(rd + 3, 0);
+    for (size_t i = 0; i < rd; ++i) {
+        unsigned long long x0 = res[0][i];
+        unsigned long long x1 = (res[1][i] + p1 - x0 % p1) * inv01 % p1;
+        unsigned long long t = (res[2][i] + 2 * p2 - x0 % p2 - x1 * (p0 % p2) % p2) % p2;
+        unsigned long long x2 = t * inv012 % p2;
+
+        unsigned long long lo = x0 + x1 * p0;
+        unsigned long long s = (lo & lo32) + x2 * (p01 & lo32);
+        acc[i] += s & lo32;
+        s = (s >> 32) + (lo >> 32) + x2 * (p01 >> 32);
+        acc[i + 1] += s & lo32;
+        acc[i + 2] += s >> 32;
+    }
+    unsigned long long carry = 0;
+    std::fill(r, r + an + bn, 0);
+    for (size_t i = 0; i < rd; ++i) {
+        carry += acc[i];
+        r[i / nttDigitsPerLimb] |= static_cast<limb_t>(carry & lo32) << (32 * (i % nttDigitsPerLimb));
+        carry >>= 32;
+    }
+}
+
+// r[0, an + bn) = a * b, picks schoolbook, karatsuba, toom-3 or ntt by operand size
+void mulLimbs(limb_t *r, const limb_t *a, size_t an, const limb_t *b, size_t bn)
+{
+    if (an < bn) {
+        std::swap(a, b);
+        std::swap(an, bn);
+    }
+    if (bn == 0) {
+        std::fill(r, r + an, 0);
+        return;
+    }
+
+    if (bn >= BigInt::nttThreshold && (an + bn) * nttDigitsPerLimb <= nttMaxLength) {
+        mulNtt(r, a, an, b, bn);
+        return;
+    }
+    if (bn >= std::max<size_t>(BigInt::toom3Threshold, 9)) {
+        if (an < 2 * bn) {
+            mulToom3(r, a, an, b, bn);
+            return;
+        }
+        // products of even chunks do not overlap in r, nor odd ones in t
+        std::fill(r, r + an + bn, 0);
+        vector<limb_t> t(an + bn);
+        TaskGroup group(parallelFor(bn));
+        for (size_t i = 0; i < an; i += bn) {
+            size_t len = std::min(bn, an - i);
+            limb_t *dst = (i / bn) & 1 ? t.data() + i : r + i;
+            group.run([=] { mulLimbs(dst, a + i, len, b, bn); });
+        }
+        group.wait();
+        addLimbs(r + bn, r + bn, an, t.data() + bn, an);
+        return;
+    }
+
+    vector<limb_t> scratch(karatsubaScratch(an, bn));
+    mulKaratsuba(r, a, an, b, bn, scratch.data());
+}
+
+// binary gcd of two limbs
+limb_t gcdLimb(limb_t a, limb_t b)
+{
+    if (!a) return b;
+    if (!b) return a;
+    unsigned int k = ctzLimb(a | b);
+    a >>= ctzLimb(a);
+    while (b) {
+        b >>= ctzLimb(b);
+        if (a > b) std::swap(a, b);
+        b -= a;
+    }
+    return a << k;
+}
+
+// trial division, for the small exponents and moduli of the root code
+bool isSmallPrime(unsigned long long n)
+{
+    if (n < 2) return false;
+    for (unsigned long long d = 2; d * d <= n; ++d)
+        if (n % d == 0) return false;
+    return true;
+}
+
+// x^e mod q for q < 2^32
+unsigned long long powModSmall(unsigned long long x, unsigned long long e, unsigned long long q)
+{
+    unsigned long long r = 1;
+    for (x %= q; e; e >>= 1) {
+        if (e & 1) r = r * x % q;
+        x = x * x % q;
+    }
+    return r;
+}
+
+// the primes up to n in order, sieving odd numbers only
+vector<unsigned int> primesUpTo(unsigned int n)
+{
+    vector<unsigned int> primes;
+    if (n < 2)
+        return primes;
+    primes.push_back(2);
+    // composite[i] stands for 2i + 1
+    vector<char> composite(n / 2 + 1);
+    for (unsigned long long i = 1; 2 * i + 1 <= n; ++i) {
+        if (composite[i])
+            continue;
+        unsigned long long p = 2 * i + 1;
+        primes.push_back(static_cast<unsigned int>(p));
+        for (unsigned long long j = p * p / 2; j <= n / 2; j += p)
+            composite[j] = 1;
+    }
+    return primes;
+}
+
+// r[0, n) = x * a + y * b for Lehmer cofactors x, y of opposite signs, the
+// result is known to be non-negative and to fit
+void lehmerCombine(limb_t *r, const limb_t *a, sdlimb_t x, const limb_t *b, sdlimb_t y, size_t n)
+{
+    if (y > 0) {
+        std::swap(a, b);
+        std::swap(x, y);
+    }
+    limb_t u = static_cast<limb_t>(x), w = static_cast<limb_t>(-y);
+    limb_t cu = 0, cw = 0, borrow = 0;
+    for (size_t i = 0; i < n; ++i) {
+        dlimb_t pu = static_cast<dlimb_t>(a[i]) * u + cu;
+        dlimb_t pw = static_cast<dlimb_t>(b[i]) * w + cw;
+        cu = static_cast<limb_t>(pu >> limbBits);
+        cw = static_cast<limb_t>(pw >> limbBits);
+        limb_t s = static_cast<limb_t>(pu), t = static_cast<limb_t>(pw);
+        limb_t d = s - t;
+        limb_t nb = s < t;
+        nb += d < borrow;
+        r[i] = d - borrow;
+        borrow = nb;
+    }
+}
+
+// r[0, n) = a * b mod B^n
+void mulLow(limb_t *r, const limb_t *a, size_t an, const limb_t *b, size_t bn, size_t n)
+{
+    std::fill(r, r + n, 0);
+    for (size_t j = 0; j < bn && j < n; ++j) {
+        size_t len = std::min(an, n - j);
+        limb_t c = addMul1(r + j, a, len, b[j]);
+        if (j + len < n) r[j + len] = c;
+    }
+}
+
+// r[0, an + bn) = a * b without the partial products a[i] * b[j] for
+// i + j < skip, short of the full product by less than an * B^(skip + 1)
+void mulHigh(limb_t *r, const limb_t *a, size_t an, const limb_t *b, size_t bn, size_t skip)
+{
+    std::fill(r, r + an + bn, 0);
+    for (size_t j = 0; j < bn; ++j) {
+        size_t i0 = j < skip ? skip - j : 0;
+        if (i0 < an)
+            r[j + an] = addMul1(r + j + i0, a + i0, an - i0, b[j]);
+    }
+}
+
+// r[0, 2n) = a^2, each cross product is formed once and doubled
+void sqrBasecase(limb_t *r, const limb_t *a, size_t n)
+{
+    std::fill(r, r + 2 * n, 0);
+    for (size_t i = 0; i + 1 < n; ++i)
+        r[i + n] = addMul1(r + 2 * i + 1, a + i + 1, n - i - 1, a[i]);
+    if (n)
+        shlLimbs(r, r, 2 * n, 1);
+    limb_t carry = 0;
+    for (size_t i = 0; i < n; ++i) {
+        dlimb_t sq = static_cast<dlimb_t>(a[i]) * a[i];
+        dlimb_t t = static_cast<dlimb_t>(r[2 * i]) + static_cast<limb_t>(sq) + carry;
+        r[2 * i] = static_cast<limb_t>(t);
+        t = static_cast<dlimb_t>(r[2 * i + 1]) + static_cast<limb_t>(sq >> limbBits) + (t >> limbBits);
+        r[2 * i + 1] = static_cast<limb_t>(t);
+        carry = static_cast<limb_t>(t >> limbBits);
+    }
+}
+
+size_t sqrScratch(size_t n)
+{
+    if (n < kThreshold())
+        return 0;
+    size_t h = (n + 1) / 2;
+    return 5 * h + 1 + sqrScratch(h);
+}
+
+// r[0, 2n) = a^2 with three half-size squarings, r must not overlap a
+void sqrKaratsuba(limb_t *r, const limb_t *a, size_t n, limb_t *scratch)
+{
+    if (n < kThreshold()) {
+        sqrBasecase(r, a, n);
+        return;
+    }
+
+    size_t h = (n + 1) / 2, n1 = n - h;
+    const limb_t *a0 = a, *a1 = a + h;
+    sqrKaratsuba(r, a0, h, scratch);
+    sqrKaratsuba(r + 2 * h, a1, n1, scratch);
+
+    limb_t *da = scratch, *prod = da + h, *mid = prod + 2 * h;
+    if (cmpLimbs(a0, h, a1, n1) >= 0) subLimbs(da, a0, h, a1, n1);
+    else {
+        std::fill(da + n1, da + h, 0);
+        subLimbs(da, a1, n1, a0, n1);
+    }
+    sqrKaratsuba(prod, da, h, mid + 2 * h + 1);
+
+    // mid = z0 + z2 - (a0 - a1)^2
+    mid[2 * h] = addLimbs(mid, r, 2 * h, r + 2 * h, 2 * n1);
+    subLimbs(mid, mid, 2 * h + 1, prod, 2 * h);
+
+    size_t len = std::min(2 * h + 1, 2 * n - h);
+    addLimbs(r + h, r + h, 2 * n - h, mid, len);
+}
+
+// r[0, 2n) = a^2, Toom-3 and NTT sizes go through mulLimbs
+void sqrLimbs(limb_t *r, const limb_t *a, size_t n)
+{
+    if (n < kThreshold()) {
+        sqrBasecase(r, a, n);
+        return;
+    }
+    if (n >= std::max<size_t>(BigInt::toom3Threshold, 9)) {
+        mulLimbs(r, a, n, a, n);
+        return;
+    }
+    vector<limb_t> scratch(sqrScratch(n));
+    sqrKaratsuba(r, a, n, scratch.data());
+}
+
+// -m0^-1 mod 2^limbBits for odd m0, each Newton step doubles the correct bits
+limb_t montInverse(limb_t m0)
+{
+    limb_t x = m0;
+    for (int i = 0; i < 5; ++i)
+        x *= 2 - m0 * x;
+    return 0 - x;
+}
+
+// r[0, n) = t / B^n mod m for t[0, 2n) below m * B^n, t is clobbered
+void montRedc(limb_t *r, limb_t *t, const limb_t *m, size_t n, limb_t minv)
+{
+    limb_t hi = 0;
+    for (size_t i = 0; i < n; ++i) {
+        limb_t c = addMul1(t + i, m, n, t[i] * minv);
+        dlimb_t s = static_cast<dlimb_t>(t[i + n]) + c + hi;
+        t[i + n] = static_cast<limb_t>(s);
+        hi = static_cast<limb_t>(s >> limbBits);
+    }
+    // below 2m, one subtraction at most
+    if (hi || cmpLimbs(t + n, n, m, n) >= 0)
+        subLimbs(r, t + n, n, m, n);
+    else
+        std::copy(t + n, t + 2 * n, r);
+}
+
+// r[0, n) = a * b / B^n mod m for a, b < m, t is 2n limbs of scratch,
+// r may alias a or b
+void montMul(limb_t *r, const limb_t *a, const limb_t *b, const limb_t *m, size_t n, limb_t minv, limb_t *t)
+{
+    if (a == b) sqrLimbs(t, a, n);
+    else mulLimbs(t, a, n, b, n);
+    montRedc(r, t, m, n, minv);
+}
+
+// decimal conversion works on the largest power of ten that fits a limb
+#if BRIGHT_LIMB_BITS == 64
+const limb_t decChunk = 10000000000000000000ull;
+const size_t decChunkDigits = 19;
+#else
+const limb_t decChunk = 1000000000u;
+const size_t decChunkDigits = 9;
+#endif
+const size_t decLeafLimbs = 16;
+
+// stream I/O moves digits in blocks of this many characters
+const size_t streamBlock = 65536;
+// decimal input is parsed in blocks of decChunk^(2^streamBlockLog) digits
+const size_t streamBlockLog = 6;
+
+const char radixDigits[] = "0123456789ABCDEF";
+
+// binary serialization header, see BigInt::serialize
+const char serialMagic[4] = { 'B', 'R', 'T', 1 };
+const size_t serialHeader = 12;
+
+bool hostLittleEndian()
+{
+    const unsigned short one = 1;
+    return *reinterpret_cast<const unsigned char *>(&one) == 1;
+}
+
+// digit values for radix parsing, -1 for anything that is not a hex digit
+struct DigitTable {
+    signed char v[256];
+
+    DigitTable()
+    {
+        std::fill(v, v + 256, -1);
+        for (int i = 0; i < 10; ++i)
+            v['0' + i] = static_cast<signed char>(i);
+        for (int i = 0; i < 6; ++i)
+            v['A' + i] = v['a' + i] = static_cast<signed char>(10 + i);
+    }
+
+    int operator[](unsigned char c) const { return v[c]; }
+} const digitValue;
+
+} // namespace
+
 BigInt::BigInt() : sign(1) {
 
 }
 
-BigInt::BigInt(const long long &v) : sign(1) {
-    *this = v;
+BigInt::BigInt(const BigInt &b) : v(b.v), sign(b.sign)
+{
+
+}
+
+// the moved-from value is left as zero
+BigInt::BigInt(BigInt &&b) noexcept : v(std::move(b.v)), sign(b.sign)
+{
+    b.sign = 1;
+}
+
+BigInt::BigInt(const long long &v) : sign(1) {
+    *this = v;
+}
+
+// packs 2^30 digits into the full-width limbs
+BigInt::BigInt(const BigInt::vector_t &v) : sign(1)
+{
+    this->v.assign((v.size() * base2 + limb_bits - 1) / limb_bits, 0);
+    for (size_t i = 0; i < v.size(); ++i) {
+        size_t at = i * base2, j = at / limb_bits;
+        unsigned int off = at % limb_bits;
+        unsigned long long d = v[i] & mask;
+        this->v[j] |= static_cast<limb_t>(d << off);
+        for (unsigned int done = limb_bits - off; done < base2; done += limb_bits)
+            this->v[++j] |= static_cast<limb_t>(d >> done);
+    }
+    trim();
+}
+
+BigInt::BigInt(const string &s, int _base) : sign(1)
+{
+    *this = fromStr(s, _base);
+}
+
+BigInt::BigInt(const char *&s, int _base) : sign(1)
+{
+    *this = fromStr(s, _base);
+}
+
+BigInt& BigInt::operator=(const BigInt &b)
+{
+    this->sign = b.sign;
+    this->v = b.v;
+    return *this;
+}
+
+BigInt& BigInt::operator=(BigInt &&b) noexcept
+{
+    this->sign = b.sign;
+    this->v = std::move(b.v);
+    b.sign = 1;
+    return *this;
+}
+
+BigInt& BigInt::operator=(long long num) {
+    this->sign = 1;
+    this->v.clear();
+    unsigned long long u = static_cast<unsigned long long>(num);
+    if (num < 0) {
+        this->sign = -1;
+        u = 0 - u;
+    }
+    // two half shifts, a full 64-bit shift of a 64-bit value is undefined
+    for (; u > 0; u = (u >> (limb_bits / 2)) >> (limb_bits / 2))
+        v.push_back(static_cast<limb_t>(u));
+    return *this;
+}
+
+BigInt BigInt::operator+(const BigInt &b) const &
+{
+    return _addSigned(*this, b, b.sign);
+}
+
+BigInt BigInt::operator-(const BigInt &b) const &
+{
+    return _addSigned(*this, b, -b.sign);
+}
+
+BigInt BigInt::operator+(const BigInt &b) &&
+{
+    return std::move(_addInPlace(b, b.sign));
+}
+
+BigInt BigInt::operator-(const BigInt &b) &&
+{
+    return std::move(_addInPlace(b, -b.sign));
+}
+
+BigInt BigInt::operator*(int b) const &
+{
+    BigInt res = *this;
+    res *= b;
+    return res;
+}
+
+BigInt BigInt::operator*(int b) &&
+{
+    return std::move(*this *= b);
+}
+
+BigInt BigInt::operator*(const BigInt &b) const
+{
+    BRIGHT_STAT(statMul, vector_size() + b.vector_size());
+    BigInt res;
+    res.v.resize(vector_size() + b.vector_size());
+    res.sign = sign * b.sign;
+    if (this == &b)
+        sqrLimbs(res.v.data(), v.data(), vector_size());
+    // products that fit inline are tiny, straight to the basecase
+    else if (res.v.isInline())
+        mulBasecase(res.v.data(), v.data(), vector_size(), b.v.data(), b.vector_size());
+    else
+        mulLimbs(res.v.data(), v.data(), vector_size(), b.v.data(), b.vector_size());
+    res.trim();
+    return res;
+}
+
+BigInt BigInt::operator/(int b) const &
+{
+    BigInt res = *this;
+    res /= b;
+    return res;
+}
+
+BigInt BigInt::operator/(int b) &&
+{
+    return std::move(*this /= b);
+}
+
+BigInt BigInt::operator/(const BigInt &b) const
+{
+    return divmod(*this, b).first;
+}
+
+unsigned long long BigInt::operator%(unsigned long long b) const
+{
+    BRIGHT_STAT(statDivSmall, vector_size());
+    unsigned long long m = 0;
+    if (limb_bits == 64 || b <= static_cast<limb_t>(~static_cast<limb_t>(0))) {
+        for (size_t i = v.size() - 1; i < v.size(); --i)
+            m = static_cast<unsigned long long>(((static_cast<dlimb_t>(m) << limb_bits) | v[i]) % b);
+        return m;
+    }
+    // b wider than a limb: feed the bits one at a time, m < b never overflows twice
+    for (size_t i = v.size() - 1; i < v.size(); --i) {
+        for (unsigned int j = limb_bits - 1; j < limb_bits; --j) {
+            unsigned long long bit = (v[i] >> j) & 1;
+            m = m >= b - m ? m - (b - m) : m + m;
+            m = m >= b - bit ? m - (b - bit) : m + bit;
+        }
+    }
+    return m;
+}
+
+BigInt BigInt::operator%(const BigInt &b) const
+{
+    return divmod(*this, b).second;
+}
+
+BigInt BigInt::operator>>(const unsigned int &b) const &
+{
+    BigInt res = *this;
+    res >>= b;
+    return res;
+}
+
+BigInt BigInt::operator>>(const unsigned int &b) &&
+{
+    return std::move(*this >>= b);
+}
+
+BigInt BigInt::operator<<(const unsigned int &b) const &
+{
+    BigInt res = *this;
+    res <<= b;
+    return res;
+}
+
+BigInt BigInt::operator<<(const unsigned int &b) &&
+{
+    return std::move(*this <<= b);
+}
+
+BigInt &BigInt::operator+=(const BigInt &b)
+{
+    return _addInPlace(b, b.sign);
+}
+
+BigInt &BigInt::operator-=(const BigInt &b)
+{
+    return _addInPlace(b, -b.sign);
+}
+
+BigInt &BigInt::operator*=(int b)
+{
+    BRIGHT_STAT(statMulSmall, vector_size());
+    BigInt& res = *this;
+    unsigned int m = static_cast<unsigned int>(b);
+    if (b < 0) {
+        res.sign *= -1;
+        m = 0u - m;
+    }
+    limb_t carry = mul1(res.v.data(), res.v.data(), res.vector_size(), m);
+    if (carry) res.v.push_back(carry);
+    res.trim();
+    return res;
+}
+
+BigInt &BigInt::operator*=(const BigInt &b)
+{
+    *this = *this * b;
+    return *this;
+}
+
+BigInt &BigInt::operator/=(int _b)
+{
+    BRIGHT_STAT(statDivSmall, vector_size());
+    auto b = static_cast<unsigned int>(_b);
+    if (_b < 0) {
+        sign = -sign;
+        b = 0u - b;
+    }
+    divRem1(v.data(), v.data(), vector_size(), b);
+    return trim();
+}
+
+BigInt &BigInt::operator/=(const BigInt &b)
+{
+    *this = *this / b;
+    return *this;
+}
+
+BigInt &BigInt::operator%=(const BigInt &b)
+{
+    *this = *this % b;
+    return *this;
+}
+
+BigInt &BigInt::operator<<=(const unsigned int &b)
+{
+    return _shl(b);
+}
+
+// rounds toward negative infinity, as an arithmetic shift of two's complement
+BigInt &BigInt::operator>>=(const unsigned int &b)
+{
+    bool lost = sign < 0 && countTrailingZeros() < b;
+    _shr(b);
+    if (lost) _addInPlace(1, -1);
+    return *this;
+}
+
+BigInt BigInt::operator&(const BigInt &b) const
+{
+    return _bitwise(b, '&');
+}
+
+BigInt BigInt::operator|(const BigInt &b) const
+{
+    return _bitwise(b, '|');
+}
+
+BigInt BigInt::operator^(const BigInt &b) const
+{
+    return _bitwise(b, '^');
+}
+
+// ~x == -x - 1
+BigInt BigInt::operator~() const
+{
+    BigInt res = -*this;
+    res -= 1;
+    return res;
+}
+
+BigInt &BigInt::operator&=(const BigInt &b)
+{
+    return *this = _bitwise(b, '&');
+}
+
+BigInt &BigInt::operator|=(const BigInt &b)
+{
+    return *this = _bitwise(b, '|');
+}
+
+BigInt &BigInt::operator^=(const BigInt &b)
+{
+    return *this = _bitwise(b, '^');
+}
+
+bool BigInt::testBit(size_t i) const
+{
+    size_t w = i / limb_bits;
+    bool bit = w < vector_size() && ((v[w] >> (i % limb_bits)) & 1);
+    if (sign > 0)
+        return bit;
+    // -x == ~(x - 1): the bits below the lowest set one stay clear, that one
+    // stays set and everything above it flips
+    size_t t = countTrailingZeros();
+    return i < t ? false : i == t ? true : !bit;
+}
+
+BigInt &BigInt::setBit(size_t i, bool value)
+{
+    if (testBit(i) == value)
+        return *this;
+    size_t w = i / limb_bits;
+    limb_t m = static_cast<limb_t>(1) << (i % limb_bits);
+    if (sign > 0) {
+        if (w >= vector_size()) v.resize(w + 1);
+        v[w] ^= m;
+        return trim();
+    }
+    // bit i is worth 2^i in two's complement as well
+    BigInt p;
+    p.v.resize(w + 1);
+    p.v[w] = m;
+    return value ? *this += p : *this -= p;
+}
+
+// bits set in |x|, the two's complement of a negative value has infinitely many
+size_t BigInt::popcount() const
+{
+    size_t c = 0;
+    for (size_t i = 0; i < vector_size(); ++i)
+        c += popcountLimb(v[i]);
+    return c;
+}
+
+// the same for x and -x, 0 for zero
+size_t BigInt::countTrailingZeros() const
+{
+    for (size_t i = 0; i < vector_size(); ++i)
+        if (v[i]) return i * limb_bits + ctzLimb(v[i]);
+    return 0;
+}
+
+// both operands are taken as two's complement one limb wider than the longer
+// magnitude, which is wide enough for the sign of the result too
+BigInt BigInt::_bitwise(const BigInt &b, char op) const
+{
+    BRIGHT_STAT(statBitwise, std::max(vector_size(), b.vector_size()));
+    size_t n = std::max(vector_size(), b.vector_size()) + 1;
+    BigInt res;
+    res.v.resize(n);
+    limb_t *r = res.v.data();
+    std::copy(v.data(), v.data() + vector_size(), r);
+    if (sign < 0) negLimbs(r, n);
+    // b goes to two's complement limb by limb, ~|b| + 1 without a buffer
+    const limb_t *y = b.v.data();
+    size_t bn = b.vector_size();
+    limb_t carry = b.sign < 0;
+    for (size_t i = 0; i < n; ++i) {
+        limb_t t = i < bn ? y[i] : 0;
+        if (b.sign < 0) {
+            t = ~t + carry;
+            carry = carry && !t;
+        }
+        if (op == '&') r[i] &= t;
+        else if (op == '|') r[i] |= t;
+        else r[i] ^= t;
+    }
+    if (r[n - 1] >> (limb_bits - 1)) {
+        negLimbs(r, n);
+        res.sign = -1;
+    }
+    res.trim();
+    return res;
+}
+
+// shift() and unshift() pop and push the lowest 2^30 digit of the magnitude
+unsigned int BigInt::shift()
+{
+    if (v.empty()) return 0u;
+    unsigned int i = static_cast<unsigned int>(v.front() & mask);
+    _shr(base2);
+    return i;
+}
+
+BigInt &BigInt::unshift(unsigned int b)
+{
+    _shl(base2);
+    if (v.empty()) v.push_back(0);
+    v.front() |= b & mask;
+    return trim();
+}
+
+
+bool BigInt::operator<(const BigInt &b) const
+{
+    if (sign != b.sign)
+        return sign < b.sign;
+    if (vector_size() != b.vector_size()) {
+        return sign > 0
+            ? vector_size() < b.vector_size()
+            : vector_size() > b.vector_size();
+    }
+    for (size_t i = vector_size() - 1; i < vector_size(); i--) {
+        if (v[i] != b.v[i]) {
+            return sign > 0
+                ? v[i] < b.v[i]
+                : v[i] > b.v[i];
+        }
+    }
+    return false;
+}
+
+bool BigInt::operator>(const BigInt &b) const
+{
+    return b < *this;
+}
+
+bool BigInt::operator<=(const BigInt &b) const
+{
+    return !(b < *this);
 }
 
-BigInt::BigInt(const BigInt::vector_t &v) : sign(1)
+bool BigInt::operator>=(const BigInt &b) const
 {
-    this->v = v;
+    return !(*this < b);
 }
 
-BigInt::BigInt(const string &s, int _base) : sign(1)
+bool BigInt::operator==(const BigInt &b) const
 {
-    *this = fromStr(s, _base);
+    if (sign != b.sign) return false;
+    if (vector_size() != b.vector_size())
+        return false;
+    for (size_t i = vector_size() - 1; i < vector_size(); i--)
+        if (v[i] != b.v[i])
+            return false;
+    return true;
 }
 
-BigInt::BigInt(const char *&s, int _base) : sign(1)
+bool BigInt::operator!=(const BigInt &b) const
 {
-    *this = fromStr(s, _base);
+    return !(*this == b);
 }
 
-BigInt& BigInt::operator=(const BigInt &b)
+BigInt BigInt::operator-() const &
 {
-    this->sign = b.sign;
-    this->v = b.v;
+    BigInt res = *this;
+    res.sign = v.empty() ? 1 : -sign;
+    return res;
+}
+
+BigInt BigInt::operator-() &&
+{
+    sign = v.empty() ? 1 : -sign;
+    return std::move(*this);
+}
+
+BigInt BigInt::abs() const &
+{
+    BigInt res = *this;
+    res.sign = 1;
+    return res;
+}
+
+BigInt BigInt::abs() &&
+{
+    sign = 1;
+    return std::move(*this);
+}
+
+BigInt &BigInt::trim()
+{
+    BRIGHT_STAT(statTrim, vector_size());
+    while (!v.empty() && !v.back()) v.pop_back();
+    if (v.empty()) sign = 1;
     return *this;
 }
 
-BigInt& BigInt::operator=(long long num) {
-    this->sign = 1;
-    this->v.clear();
-    if (num < 0) {
-        this->sign = -1;
-        num = -num;
+// magnitude shifts by a bit count, the sign is kept
+BigInt &BigInt::_shl(size_t bits)
+{
+    BRIGHT_STAT(statShift, vector_size());
+    if (v.empty()) return *this;
+    size_t limbs = bits / limb_bits;
+    unsigned int s = bits % limb_bits;
+    if (s) {
+        limb_t out = shlLimbs(v.data(), v.data(), vector_size(), s);
+        if (out) v.push_back(out);
+    }
+    v.insert(v.begin(), limbs, 0);
+    return *this;
+}
+
+BigInt &BigInt::_shr(size_t bits)
+{
+    BRIGHT_STAT(statShift, vector_size());
+    size_t limbs = bits / limb_bits;
+    if (limbs >= vector_size()) {
+        v.clear();
+        return trim();
+    }
+    v.erase(v.begin(), v.begin() + static_cast<long long>(limbs));
+    unsigned int s = bits % limb_bits;
+    if (s) shrLimbs(v.data(), v.data(), vector_size(), s);
+    return trim();
+}
+
+// a + bsign * |b| into a fresh result
+BigInt BigInt::_addSigned(const BigInt &a, const BigInt &b, int bsign)
+{
+    BRIGHT_STAT(statAdd, std::max(a.vector_size(), b.vector_size()));
+    BigInt res;
+    // single-limb operands skip the kernels, the result stays inline
+    if (a.vector_size() <= 1 && b.vector_size() <= 1) {
+        limb_t x = a.v.empty() ? 0 : a.v[0], y = b.v.empty() ? 0 : b.v[0];
+        if (a.sign == bsign) {
+            res.v.push_back(x + y);
+            if (res.v[0] < x) res.v.push_back(1);
+            res.sign = a.sign;
+        } else {
+            res.v.push_back(x >= y ? x - y : y - x);
+            res.sign = x >= y ? a.sign : -a.sign;
+        }
+        res.trim();
+        return res;
+    }
+    if (a.sign == bsign) {
+        const BigInt &x = a.vector_size() >= b.vector_size() ? a : b;
+        const BigInt &y = a.vector_size() >= b.vector_size() ? b : a;
+        res.v.resize(x.vector_size() + 1);
+        res.v.back() = addLimbs(res.v.data(), x.v.data(), x.vector_size(), y.v.data(), y.vector_size());
+        res.sign = a.sign;
+        res.trim();
+        return res;
+    }
+    int c = cmpLimbs(a.v.data(), a.vector_size(), b.v.data(), b.vector_size());
+    const BigInt &x = c >= 0 ? a : b;
+    const BigInt &y = c >= 0 ? b : a;
+    res.v.resize(x.vector_size());
+    subLimbs(res.v.data(), x.v.data(), x.vector_size(), y.v.data(), y.vector_size());
+    res.sign = c >= 0 ? a.sign : -a.sign;
+    res.trim();
+    return res;
+}
+
+// *this += bsign * |b| without a temporary, b may be *this itself
+BigInt &BigInt::_addInPlace(const BigInt &b, int bsign)
+{
+    BRIGHT_STAT(statAdd, std::max(vector_size(), b.vector_size()));
+    size_t n = vector_size(), bn = b.vector_size();
+    if (sign == bsign) {
+        size_t m = std::max(n, bn);
+        v.resize(m + 1);
+        v[m] = addLimbs(v.data(), v.data(), m, b.v.data(), bn);
+        return trim();
+    }
+    if (cmpLimbs(v.data(), n, b.v.data(), bn) >= 0) {
+        subLimbs(v.data(), v.data(), n, b.v.data(), bn);
+    } else {
+        // |b| > |*this|, so b is not *this
+        v.resize(bn);
+        subLimbs(v.data(), b.v.data(), bn, v.data(), n);
+        sign = -sign;
+    }
+    return trim();
+}
+
+size_t BigInt::size() const
+{
+    if (v.empty()) return 0;
+    return (v.size() - 1) * limb_bits + bitLength(v.back());
+}
+
+inline size_t BigInt::vector_size() const
+{
+    return this->v.size();
+}
+
+// bases 2, 8, 10 and 16 are supported, anything else throws
+BigInt BigInt::fromStr(const string &s, int _base)
+{
+    BRIGHT_STAT(statFromStr, 0);
+    if (_base != 2 && _base != 8 && _base != 10 && _base != 16)
+        throw std::invalid_argument("unsupported base");
+    BigInt res;
+    size_t pos = 0;
+    while (pos != s.size() && (s[pos] == '-' || s[pos] == '+')) {
+        if (s[pos] == '-')
+            res.sign = -res.sign;
+        ++pos;
+    }
+    if (_base == 10) {
+        res.v = _fromBase10Str(s.substr(pos));
+    } else {
+        if (_base == 16 && s.size() - pos >= 2 && s[pos] == '0' && (s[pos + 1] == 'x' || s[pos + 1] == 'X'))
+            pos += 2;
+        res.v = _fromBase2kStr(s, pos, _base == 2 ? 1 : _base == 8 ? 3 : 4);
+    }
+    BRIGHT_STAT_LIMBS(res.vector_size());
+    res.trim();
+    return res;
+}
+
+string BigInt::toStr(int _base) const
+{
+    BRIGHT_STAT(statToStr, vector_size());
+    if (_base != 2 && _base != 8 && _base != 10 && _base != 16)
+        throw std::invalid_argument("unsupported base");
+    if (vector_size() == 0) return "0";
+
+    if (_base == 10) {
+        string res = this->sign == 1 ? "" : "-";
+        res.reserve(res.size() + size() * 30103 / 100000 + 1);
+        _toBase10Str(abs(), 0, res, nullptr);
+        return res;
+    }
+
+    return _toBase2kStr(_base == 2 ? 1 : _base == 8 ? 3 : 4);
+}
+
+// count words of size bytes, order 1 for the most significant word first and
+// -1 for the least, endian 1 for big-endian words, -1 little, 0 native; the
+// result is non-negative. Little-endian bytes in a little-endian host's limb
+// order are copied in one piece
+BigInt BigInt::fromBytes(const void *src, size_t count, size_t size, int order, int endian)
+{
+    if (size == 0 || (order != 1 && order != -1) || endian < -1 || endian > 1)
+        throw std::invalid_argument("bad word layout");
+    const unsigned char *p = static_cast<const unsigned char *>(src);
+    size_t bytes = count * size;
+    if (!endian) endian = hostLittleEndian() ? -1 : 1;
+
+    BigInt res;
+    res.v.resize((bytes + sizeof(limb_t) - 1) / sizeof(limb_t));
+    if (hostLittleEndian() && endian < 0 && (order < 0 || count == 1)) {
+        if (bytes)
+            std::memcpy(res.v.data(), p, bytes);
+        res.trim();
+        return res;
+    }
+    // k counts bytes from the least significant one
+    for (size_t i = 0, k = 0; i < count; ++i) {
+        const unsigned char *w = p + (order < 0 ? i : count - 1 - i) * size;
+        for (size_t j = 0; j < size; ++j, ++k)
+            res.v[k / sizeof(limb_t)] |= static_cast<limb_t>(w[endian < 0 ? j : size - 1 - j]) << (8 * (k % sizeof(limb_t)));
+    }
+    res.trim();
+    return res;
+}
+
+// writes |*this| in the layout of fromBytes and returns the number of words;
+// a null dst only counts them. Zero takes no words
+size_t BigInt::toBytes(void *dst, size_t size, int order, int endian) const
+{
+    if (size == 0 || (order != 1 && order != -1) || endian < -1 || endian > 1)
+        throw std::invalid_argument("bad word layout");
+    size_t count = (this->size() + 8 * size - 1) / (8 * size);
+    if (!dst)
+        return count;
+    unsigned char *p = static_cast<unsigned char *>(dst);
+    size_t bytes = count * size, have = vector_size() * sizeof(limb_t);
+    if (!endian) endian = hostLittleEndian() ? -1 : 1;
+
+    if (hostLittleEndian() && endian < 0 && (order < 0 || count == 1)) {
+        std::memcpy(p, v.data(), std::min(bytes, have));
+        if (bytes > have) std::fill(p + have, p + bytes, 0);
+        return count;
+    }
+    for (size_t i = 0, k = 0; i < count; ++i) {
+        unsigned char *w = p + (order < 0 ? i : count - 1 - i) * size;
+        for (size_t j = 0; j < size; ++j, ++k) {
+            unsigned char b = k < have ? static_cast<unsigned char>(v[k / sizeof(limb_t)] >> (8 * (k % sizeof(limb_t)))) : 0;
+            w[endian < 0 ? j : size - 1 - j] = b;
+        }
+    }
+    return count;
+}
+
+// the serialized form: the magic "BRT\1", then 8 little-endian bytes holding
+// twice the magnitude length in bytes, plus one when negative, then the
+// magnitude as little-endian bytes
+size_t BigInt::serializedSize() const
+{
+    return serialHeader + toBytes(nullptr, 1, -1, -1);
+}
+
+size_t BigInt::serialize(void *dst) const
+{
+    unsigned char *p = static_cast<unsigned char *>(dst);
+    size_t bytes = toBytes(p + serialHeader, 1, -1, -1);
+    unsigned long long word = (static_cast<unsigned long long>(bytes) << 1) | (sign < 0 ? 1 : 0);
+    std::memcpy(p, serialMagic, 4);
+    for (int i = 0; i < 8; ++i)
+        p[4 + i] = static_cast<unsigned char>(word >> (8 * i));
+    return serialHeader + bytes;
+}
+
+// src may point straight into a mapped file, len bounds what is read
+BigInt BigInt::deserialize(const void *src, size_t len)
+{
+    const unsigned char *p = static_cast<const unsigned char *>(src);
+    if (len < serialHeader || std::memcmp(p, serialMagic, 4))
+        throw std::invalid_argument("not a serialized BigInt");
+    unsigned long long word = 0;
+    for (int i = 7; i >= 0; --i)
+        word = (word << 8) | p[4 + i];
+    if ((word >> 1) > len - serialHeader)
+        throw std::invalid_argument("truncated BigInt");
+    BigInt res = fromBytes(p + serialHeader, static_cast<size_t>(word >> 1), 1, -1, -1);
+    if ((word & 1) && !res.v.empty())
+        res.sign = -1;
+    return res;
+}
+
+void BigInt::save(const string &path) const
+{
+    vector<char> buf(serializedSize());
+    serialize(buf.data());
+    std::ofstream out(path, std::ios::binary);
+    if (!out.write(buf.data(), static_cast<std::streamsize>(buf.size())))
+        throw std::runtime_error("cannot write " + path);
+}
+
+// maps the file where mmap is available, reads it otherwise
+BigInt BigInt::load(const string &path)
+{
+#if defined(__unix__) || defined(__APPLE__)
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("cannot open " + path);
+    struct stat st;
+    if (::fstat(fd, &st) < 0 || st.st_size == 0) {
+        ::close(fd);
+        throw std::runtime_error("cannot read " + path);
+    }
+    size_t len = static_cast<size_t>(st.st_size);
+    void *map = ::mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED)
+        throw std::runtime_error("cannot map " + path);
+    try {
+        BigInt res = deserialize(map, len);
+        ::munmap(map, len);
+        return res;
+    } catch (...) {
+        ::munmap(map, len);
+        throw;
+    }
+#else
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        throw std::runtime_error("cannot open " + path);
+    vector<char> buf((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    return deserialize(buf.data(), buf.size());
+#endif
+}
+
+// packs digits of 2^bits straight into limbs, least significant digit first
+BigInt::limb_vector BigInt::_fromBase2kStr(const string &s, size_t pos, unsigned int bits)
+{
+    limb_vector v;
+    v.reserve(((s.size() - pos) * bits + limb_bits - 1) / limb_bits);
+    limb_t acc = 0;
+    unsigned int accBits = 0;
+    for (size_t i = s.size(); i-- > pos; ) {
+        int d = digitValue[static_cast<unsigned char>(s[i])];
+        if (d < 0 || d >> bits)
+            throw std::invalid_argument("wrong base");
+        acc |= static_cast<limb_t>(d) << accBits;
+        accBits += bits;
+        if (accBits >= limb_bits) {
+            // the digit may straddle two limbs
+            v.push_back(acc);
+            accBits -= limb_bits;
+            acc = static_cast<limb_t>(d) >> (bits - accBits);
+        }
+    }
+    if (acc != 0)
+        v.push_back(acc);
+    while (!v.empty() && !v.back()) v.pop_back();
+    return v;
+}
+
+// unpacks 2^bits digits straight out of the limbs into a single string,
+// sign included
+string BigInt::_toBase2kStr(unsigned int bits) const
+{
+    size_t n = (size() + bits - 1) / bits;
+    string res(sign < 0 ? n + 1 : n, '-');
+    for (size_t j = 0; j < n; ++j) {
+        size_t at = j * bits, i = at / limb_bits;
+        unsigned int off = at % limb_bits;
+        limb_t d = v[i] >> off;
+        if (off + bits > limb_bits && i + 1 < vector_size())
+            d |= v[i + 1] << (limb_bits - off);
+        res[res.size() - 1 - j] = radixDigits[d & ((1u << bits) - 1)];
+    }
+    return res;
+}
+
+BigInt::limb_vector BigInt::_fromBase10Str(const string &s)
+{
+    for (auto i = s.begin(); i != s.end(); i++) {
+        int what = (*i - '0');
+        if (what < 0 || what > 9)
+            throw std::invalid_argument("wrong base");
+    }
+    return _fromBase10Range(s.data(), s.data() + s.size()).v;
+}
+
+// digits in [first, last) are already validated; short inputs take one chunk
+// of digits per limb pass, long ones split by the cached powers of ten
+BigInt BigInt::_fromBase10Range(const char *first, const char *last)
+{
+    BigInt res;
+    size_t n = static_cast<size_t>(last - first);
+    if (n <= decLeafLimbs * decChunkDigits) {
+        size_t len = n % decChunkDigits ? n % decChunkDigits : decChunkDigits;
+        for (const char *p = first; p != last; p += len, len = decChunkDigits) {
+            limb_t carry = 0;
+            for (size_t i = 0; i < len; ++i)
+                carry = carry * 10 + static_cast<unsigned int>(p[i] - '0');
+            carry = mul1(res.v.data(), res.v.data(), res.vector_size(), decChunk, carry);
+            if (carry) res.v.push_back(carry);
+        }
+        return res;
+    }
+
+    // low part takes the largest chunk * 2^k digits that leave a non-empty high part
+    size_t k = 0;
+    while ((decChunkDigits << (k + 1)) < n)
+        ++k;
+    size_t low = decChunkDigits << k;
+    BigInt lo;
+    TaskGroup group(parallelFor(low / decChunkDigits));
+    group.run([&] { lo = _fromBase10Range(last - low, last); });
+    res = _fromBase10Range(first, last - low) * _pow10(k);
+    group.wait();
+    res += lo;
+    return res;
+}
+
+// decChunk^(2^k), cached across calls, references stay valid as the cache grows
+const BigInt& BigInt::_pow10(size_t k)
+{
+    static std::deque<BigInt> cache;
+    static std::mutex lock;
+    std::lock_guard<std::mutex> guard(lock);
+    // the cache outlives any resource the caller has in scope
+    DefaultResource scope;
+    if (cache.empty()) {
+        cache.push_back(BigInt());
+        cache.back().v.push_back(decChunk);
+    }
+    while (cache.size() <= k)
+        cache.push_back(cache.back() * cache.back());
+    return cache[k];
+}
+
+// appends the digits of x >= 0, left-padded with zeros to width digits,
+// splitting by the cached powers of ten down to decChunk-sized pieces; with
+// os given, out is flushed to it whenever it grows past a block
+void BigInt::_toBase10Str(const BigInt &x, size_t width, string &out, ostream *os)
+{
+    if (x.vector_size() <= decLeafLimbs) {
+        vector<limb_t> chunks;
+        limb_vector t = x.v;
+        while (!t.empty()) {
+            limb_t rem = 0;
+            for (size_t i = t.size() - 1; i < t.size(); --i) {
+                dlimb_t cur = (static_cast<dlimb_t>(rem) << limb_bits) | t[i];
+                t[i] = static_cast<limb_t>(cur / decChunk);
+                rem = static_cast<limb_t>(cur % decChunk);
+            }
+            while (!t.empty() && !t.back()) t.pop_back();
+            chunks.push_back(rem);
+        }
+        string s;
+        for (size_t i = chunks.size() - 1; i < chunks.size(); --i) {
+            string c = std::to_string(chunks[i]);
+            if (i != chunks.size() - 1)
+                s.append(decChunkDigits - c.size(), '0');
+            s += c;
+        }
+        if (s.size() < width)
+            out.append(width - s.size(), '0');
+        out += s;
+        if (os && out.size() >= streamBlock) {
+            os->write(out.data(), static_cast<std::streamsize>(out.size()));
+            out.clear();
+        }
+        return;
+    }
+
+    // largest k with decChunk^(2^k) at most about half as long as x
+    size_t k = 0;
+    while (_pow10(k + 1).vector_size() * 2 <= x.vector_size() + 1)
+        ++k;
+    const BigInt &p = _pow10(k);
+    size_t low = decChunkDigits << k;
+    auto qr = divmod(x, p);
+    size_t highWidth = width > low ? width - low : 0;
+    if (os || !parallelFor(p.vector_size())) {
+        _toBase10Str(qr.first, highWidth, out, os);
+        qr.first = BigInt();
+        _toBase10Str(qr.second, low, out, os);
+        return;
+    }
+    string lo;
+    TaskGroup group(true);
+    group.run([&] { _toBase10Str(qr.second, low, lo, nullptr); });
+    _toBase10Str(qr.first, highWidth, out, nullptr);
+    group.wait();
+    out += lo;
+}
+
+// limbs [from, from + count) of the magnitude, as a non-negative value
+BigInt BigInt::_limbs(size_t from, size_t count) const
+{
+    BigInt res;
+    if (from < vector_size()) {
+        size_t to = std::min(vector_size(), from + count);
+        res.v.resize(to - from);
+        std::copy(v.data() + from, v.data() + to, res.v.data());
+    }
+    res.trim();
+    return res;
+}
+
+// schoolbook division of the magnitudes, both results non-negative
+std::pair<BigInt, BigInt> BigInt::_divmodBasecase(const BigInt &a, const BigInt &b)
+{
+    size_t an = a.vector_size(), bn = b.vector_size();
+    BigInt q, r;
+    if (cmpLimbs(a.v.data(), an, b.v.data(), bn) < 0) {
+        r = a.abs();
+        return make_pair(std::move(q), std::move(r));
+    }
+
+    q.v.resize(an - bn + 1);
+    if (bn == 1) {
+        r.v.push_back(divRem1(q.v.data(), a.v.data(), an, b.v[0]));
+    } else {
+        // shift so the top limb of b has its high bit set, the remainder
+        // is worked out in place in r and shifted back at the end
+        unsigned int norm = limb_bits - bitLength(b.v.back());
+        limb_vector d(b.v);
+        r.v.resize(an + 1);
+        if (norm) {
+            shlLimbs(d.data(), d.data(), bn, norm);
+            r.v[an] = shlLimbs(r.v.data(), a.v.data(), an, norm);
+        } else {
+            std::copy(a.v.data(), a.v.data() + an, r.v.data());
+            r.v[an] = 0;
+        }
+        divLimbs(q.v.data(), r.v.data(), an, d.data(), bn);
+        r.v.resize(bn);
+        if (norm) shrLimbs(r.v.data(), r.v.data(), bn, norm);
+    }
+    q.trim();
+    r.trim();
+    return make_pair(std::move(q), std::move(r));
+}
+
+// Burnikel-Ziegler: 0 <= a < b * B^n, b has exactly n limbs and its top bit set
+std::pair<BigInt, BigInt> BigInt::_div2n1n(const BigInt &a, const BigInt &b, size_t n)
+{
+    if (n % 2 || n <= divThreshold)
+        return _divmodBasecase(a, b);
+    size_t k = n / 2;
+    auto hi = _div3n2n(a._limbs(k, 3 * k), b, k);
+    hi.second._shl(k * limb_bits) += a._limbs(0, k);
+    auto lo = _div3n2n(hi.second, b, k);
+    hi.first._shl(k * limb_bits) += lo.first;
+    return make_pair(std::move(hi.first), std::move(lo.second));
+}
+
+// 0 <= a < b * B^k, b has exactly 2k limbs and its top bit set
+std::pair<BigInt, BigInt> BigInt::_div3n2n(const BigInt &a, const BigInt &b, size_t k)
+{
+    BigInt b1 = b._limbs(k, k);
+    BigInt a12 = a._limbs(k, 2 * k);
+    std::pair<BigInt, BigInt> qr;
+    if (a._limbs(2 * k, k) < b1) {
+        qr = _div2n1n(a12, b1, k);
+    } else {
+        // the top limbs of a and b are equal, the quotient is B^k - 1
+        qr.first.v.assign(k, ~static_cast<limb_t>(0));
+        qr.second = a12 + b1 - BigInt(b1)._shl(k * limb_bits);
+    }
+    BigInt &q = qr.first, &r = qr.second;
+    r._shl(k * limb_bits) += a._limbs(0, k);
+    r -= q * b._limbs(0, k);
+    // at most two corrections
+    while (r < 0) {
+        q -= 1;
+        r += b;
+    }
+    return qr;
+}
+
+// magnitudes split into blocks of n limbs, with n padded to j * 2^m so the
+// recursion halves evenly down to j <= divThreshold
+std::pair<BigInt, BigInt> BigInt::_divmodRecursive(const BigInt &a, const BigInt &b)
+{
+    size_t bn = b.vector_size(), m = 0;
+    while ((bn >> m) > divThreshold)
+        ++m;
+    size_t n = ((bn + (static_cast<size_t>(1) << m) - 1) >> m) << m;
+    size_t sigma = (n - bn) * limb_bits + limb_bits - bitLength(b.v.back());
+    BigInt bs = b.abs()._shl(sigma);
+    BigInt as = a.abs()._shl(sigma);
+
+    // the top block must stay below bs, so it needs a clear high bit
+    size_t blockBits = n * limb_bits;
+    size_t t = std::max<size_t>(2, (as.size() + blockBits) / blockBits);
+    BigInt q, z = as._limbs((t - 2) * n, 2 * n);
+    q.v.resize((t - 1) * n);
+    for (size_t i = t - 2; ; --i) {
+        auto qr = _div2n1n(z, bs, n);
+        std::copy(qr.first.v.data(), qr.first.v.data() + qr.first.vector_size(), q.v.data() + i * n);
+        if (i == 0) {
+            q.trim();
+            qr.second._shr(sigma);
+            return make_pair(std::move(q), std::move(qr.second));
+        }
+        z = std::move(qr.second._shl(blockBits));
+        z += as._limbs((i - 1) * n, n);
+    }
+}
+
+std::pair<BigInt, BigInt> divmod(const BigInt &a1, const BigInt &b1) {
+    BRIGHT_STAT(statDivmod, a1.vector_size());
+    if (b1.v.empty())
+        throw std::invalid_argument("division by zero");
+    size_t an = a1.vector_size(), bn = b1.vector_size();
+    auto qr = bn > BigInt::divThreshold && an > bn + BigInt::divThreshold
+        ? BigInt::_divmodRecursive(a1, b1)
+        : BigInt::_divmodBasecase(a1, b1);
+    qr.first.sign = a1.sign * b1.sign;
+    qr.second.sign = a1.sign;
+    qr.first.trim();
+    qr.second.trim();
+    return qr;
+}
+
+// Knuth's Algorithm L on the leading limbs while b has two limbs or more, then
+// plain Euclid (or binary gcd without cofactors); s, when given, receives the
+// cofactor of a0 in a0 * s + b0 * t = gcd
+BigInt BigInt::_gcd(const BigInt &a0, const BigInt &b0, BigInt *s)
+{
+    BRIGHT_STAT(statGcd, std::max(a0.vector_size(), b0.vector_size()));
+    BigInt a = a0.abs(), b = b0.abs(), sa = 1, sb = 0;
+    if (a < b) {
+        std::swap(a, b);
+        std::swap(sa, sb);
+    }
+    auto cofactor = [](sdlimb_t x) {
+        BigInt c;
+        c.v.push_back(static_cast<limb_t>(x < 0 ? -x : x));
+        c.sign = x < 0 ? -1 : 1;
+        c.trim();
+        return c;
+    };
+
+    while (b.vector_size() >= 2) {
+        size_t n = a.vector_size();
+        b.v.resize(n);
+        unsigned int sh = limb_bits - bitLength(a.v[n - 1]);
+        limb_t ah = a.v[n - 1] << sh, bh = b.v[n - 1] << sh;
+        if (sh) {
+            ah |= a.v[n - 2] >> (limb_bits - sh);
+            bh |= b.v[n - 2] >> (limb_bits - sh);
+        }
+
+        // simulate Euclid on the leading limbs while both quotient bounds agree
+        sdlimb_t x = ah, y = bh, A = 1, B = 0, C = 0, D = 1;
+        while (y + C > 0 && y + D > 0) {
+            sdlimb_t q = (x + A) / (y + C);
+            if (q != (x + B) / (y + D))
+                break;
+            sdlimb_t t = A - q * C;
+            A = C;
+            C = t;
+            t = B - q * D;
+            B = D;
+            D = t;
+            t = x - q * y;
+            x = y;
+            y = t;
+        }
+
+        if (B == 0) {
+            // no progress from the leading limbs, one full division step
+            b.trim();
+            auto qr = divmod(a, b);
+            a = std::move(b);
+            b = std::move(qr.second);
+            if (s) {
+                sa -= qr.first * sb;
+                std::swap(sa, sb);
+            }
+            continue;
+        }
+        BigInt na, nb;
+        na.v.resize(n);
+        nb.v.resize(n);
+        lehmerCombine(na.v.data(), a.v.data(), A, b.v.data(), B, n);
+        lehmerCombine(nb.v.data(), a.v.data(), C, b.v.data(), D, n);
+        a = std::move(na.trim());
+        b = std::move(nb.trim());
+        if (s) {
+            BigInt ns = sa * cofactor(A) + sb * cofactor(B);
+            sb = sa * cofactor(C) + sb * cofactor(D);
+            sa = std::move(ns);
+        }
+    }
+
+    if (!s) {
+        if (b.v.empty())
+            return a;
+        BigInt g;
+        g.v.push_back(gcdLimb(b.v[0], static_cast<limb_t>(a % static_cast<unsigned long long>(b.v[0]))));
+        return g;
     }
-    for (; num > 0; num = num / base)
-        v.push_back(num % base);
-    return *this;
+    while (!b.v.empty()) {
+        auto qr = divmod(a, b);
+        a = std::move(b);
+        b = std::move(qr.second);
+        sa -= qr.first * sb;
+        std::swap(sa, sb);
+    }
+    *s = std::move(sa);
+    return a;
 }
 
-BigInt BigInt::operator+(const BigInt &b) const
+BigInt gcd(const BigInt &a, const BigInt &b)
 {
-    if (sign != b.sign)
-        return *this - (-b);
-    BigInt res = b;
-    size_t q = std::max(vector_size(), b.vector_size());
-    unsigned int carry = 0;
-    for (unsigned int i = 0; i < q || carry; ++i) {
-        if (i == res.vector_size()) res.v.push_back(0);
-        res.v[i] += carry + (i < vector_size() ? v[i] : 0);
-        carry = res.v[i] >= base;
-        if (carry) res.v[i] -= base;
-    }
-    return res;
+    return BigInt::_gcd(a, b, nullptr);
 }
 
-BigInt BigInt::operator-(const BigInt &b) const
+BigInt lcm(const BigInt &a, const BigInt &b)
 {
-    if (sign != b.sign)
-        return *this + (-b);
-    if (abs() >= b.abs()) {
-        BigInt res = *this;
-        unsigned int carry = 0;
-        for (size_t i = 0; i < b.vector_size() || carry; ++i) {
-            unsigned int temp = carry + (i < b.vector_size() ? static_cast<unsigned int>(b.v[i]) : 0);
-            if (res.v[i] >= temp) {
-                res.v[i] -= temp;
-                carry = 0;
-            }
-            else {
-                res.v[i] = res.v[i] - temp + base;
-                carry = 1;
-            }
-        }
-        res.trim();
-        return res;
-    }
-    return -(b - *this);
+    if (a.v.empty() || b.v.empty())
+        return BigInt();
+    return (a / gcd(a, b) * b).abs();
 }
 
-BigInt BigInt::operator*(int b) const
+// g = gcd(a, b) >= 0 with a * s + b * t == g
+BigInt gcdext(const BigInt &a, const BigInt &b, BigInt &s, BigInt &t)
 {
-    BigInt res = *this;
-    return res *= b;
+    BigInt g = BigInt::_gcd(a, b, &s);
+    if (a.sign < 0) s = -s;
+    t = b.v.empty() ? BigInt() : (g - a * s) / b;
+    return g;
 }
 
-BigInt BigInt::operator*(const BigInt &b) const
+// the inverse of a modulo |m| in [0, |m|), throws when gcd(a, m) != 1
+BigInt modinv(const BigInt &a, const BigInt &m)
 {
-    // " << 1 " is of the same complexity as " << i "
-    BigInt res(0);
-    for (unsigned int i = 0; i < b.vector_size(); i++) {
-        res += [&] {
-            BigInt t = *this * static_cast<int>(b.v[i]);
-            t.sign = 1;
-            t <<= i;
-            return t;
-        }();
+    BigInt s, t;
+    BigInt g = gcdext(a, m, s, t);
+    if (g != 1)
+        throw std::invalid_argument("not invertible");
+    BigInt r = s % m;
+    if (r.sign < 0) r += m.abs();
+    return r;
+}
+
+// x^k by square-and-multiply
+BigInt BigInt::_pow(const BigInt &x, unsigned int k)
+{
+    BigInt res = 1, sq = x;
+    for (; k; k >>= 1) {
+        if (k & 1) res *= sq;
+        if (k > 1) sq *= sq;
     }
-    res.sign = sign * b.sign;
     return res;
 }
 
-BigInt BigInt::operator/(int _b) const
+// log2 of a positive value from its top 64 bits
+double BigInt::_log2() const
 {
-    BigInt res = *this;
-    if (_b < 0) {
-        res.sign = -res.sign;
-        _b = -_b;
+    size_t bits = size(), low = bits > 64 ? bits - 64 : 0;
+    BigInt t = *this >> static_cast<unsigned int>(low);
+    double top = 0;
+    for (size_t i = t.vector_size(); i-- > 0; )
+        top = top * std::ldexp(1.0, limb_bits) + static_cast<double>(t.v[i]);
+    return std::log2(top) + static_cast<double>(low);
+}
+
+// floor(n^(1/k)) for n > 0 and k >= 2. The starting point is the root of the
+// top half of the bits, found recursively, or a double estimate once the root
+// fits in 48 bits; each level then needs about one Newton step, so the work
+// is dominated by the step at full size
+BigInt BigInt::_iroot(const BigInt &n, unsigned int k)
+{
+    size_t bits = n.size();
+    if (k >= bits)
+        return BigInt(1);
+    size_t rbits = (bits - 1) / k + 1;
+
+    BigInt x;
+    if (rbits <= 48) {
+        x = static_cast<long long>(std::exp2(n._log2() / k)) + 1;
+    } else {
+        // keeping the error of x below 2^m leaves under 1/16 after one step
+        size_t m = (rbits - 4 - bitLength(k)) / 2;
+        x = _iroot(n >> static_cast<unsigned int>(k * m), k) + 1;
+        x._shl(m);
     }
-    auto b = static_cast<unsigned int>(_b);
-    unsigned long long rem = 0;
-    for (size_t i = v.size() - 1; i < v.size(); --i) {
-        unsigned long long cur = v[i] + rem * base;
-        res.v[i] = static_cast<unsigned int>(cur / b);
-        rem = static_cast<unsigned int>(cur % b);
+
+    // any positive x steps to at least the root, and strictly down while it
+    // is above it, so this ends on floor(n^(1/k))
+    BigInt p = _pow(x, k - 1);
+    for (bool first = true; first || p * x > n; first = false) {
+        x = (x * static_cast<int>(k - 1) + n / p) / static_cast<int>(k);
+        p = _pow(x, k - 1);
     }
-    res.trim();
-    return res;
+    return x;
 }
 
-BigInt BigInt::operator/(const BigInt &b) const
+BigInt isqrt(const BigInt &a)
 {
-    return divmod(*this, b).first;
+    return iroot(a, 2);
 }
 
-unsigned long long BigInt::operator%(unsigned long long b) const
+// the k-th root truncated toward zero, negative a needs an odd k
+BigInt iroot(const BigInt &a, unsigned int k)
 {
-    unsigned long long m = 0;
-    for (size_t i = v.size() - 1; i < v.size(); --i)
-        m = (v[i] + m * base) % b;
-    return m;
+    BRIGHT_STAT(statRoot, a.vector_size());
+    if (k == 0)
+        throw std::invalid_argument("zeroth root");
+    if (a.sign < 0 && !(k & 1))
+        throw std::invalid_argument("even root of a negative number");
+    if (a.v.empty() || k == 1)
+        return a;
+    BigInt r = BigInt::_iroot(a.abs(), k);
+    r.sign = a.sign;
+    return r;
 }
 
-BigInt BigInt::operator%(const BigInt &b) const
+bool isPerfectSquare(const BigInt &a)
 {
-    return divmod(*this, b).second;
+    if (a.sign < 0)
+        return false;
+    if (a.v.empty())
+        return true;
+    // squares take only 12 of the 64 residues mod 64
+    if (!((0x0202021202030213ull >> (a.v[0] & 63)) & 1))
+        return false;
+    BigInt r = isqrt(a);
+    return r * r == a;
 }
 
-BigInt BigInt::operator>>(const unsigned int &b) const
+// a == b^k for some integer b and k >= 2; 0, 1 and -1 count. Only prime k
+// are tried, and most of them are ruled out without taking a root
+bool isPerfectPower(const BigInt &a)
 {
-    BigInt res = *this;
-    res.v.erase(res.v.begin(), res.v.begin() + static_cast<long long>(b));
-    return res;
+    BigInt n = a.abs();
+    if (n.vector_size() <= 1 && (n.v.empty() || n.v[0] == 1))
+        return true;
+    // b^k == n makes k divide every exponent of n, that of 2 included
+    size_t tz = n.countTrailingZeros(), bits = n.size();
+    if (tz == 1)
+        return false;
+    unsigned long long low = n.v[0];
+#if BRIGHT_LIMB_BITS == 32
+    if (n.vector_size() > 1) low |= static_cast<unsigned long long>(n.v[1]) << 32;
+#endif
+    double lg = n._log2();
+
+    for (unsigned int k = a.sign < 0 ? 3 : 2; k <= bits; ++k) {
+        if ((tz && tz % k) || !isSmallPrime(k))
+            continue;
+        if (k == 2) {
+            if (isPerfectSquare(n)) return true;
+            continue;
+        }
+        size_t rbits = (bits - 1) / k + 1;
+        if (rbits <= 40) {
+            // the root is within one of the double estimate, and its k-th
+            // power has to agree with n in the low 64 bits
+            unsigned long long r0 = static_cast<unsigned long long>(std::llround(std::exp2(lg / k)));
+            for (unsigned long long r = r0 > 2 ? r0 - 1 : 2; r <= r0 + 1; ++r) {
+                unsigned long long p = 1, x = r;
+                for (unsigned int e = k; e; e >>= 1, x *= x)
+                    if (e & 1) p *= x;
+                if (p == low && BigInt::_pow(BigInt(static_cast<long long>(r)), k) == n)
+                    return true;
+            }
+            continue;
+        }
+        // a k-th power is a k-th power residue modulo each prime q = 1 mod k,
+        // which only one in k residues is
+        bool residue = true;
+        for (unsigned long long q = 2 * k + 1, tried = 0; tried < 4 && residue; q += 2 * k) {
+            if (!isSmallPrime(q)) continue;
+            unsigned long long nq = n % q;
+            residue = nq == 0 || powModSmall(nq, (q - 1) / k, q) == 1;
+            ++tried;
+        }
+        if (residue && BigInt::_pow(BigInt::_iroot(n, k), k) == n)
+            return true;
+    }
+    return false;
 }
 
-BigInt BigInt::operator<<(const unsigned int &b) const
+// sliding-window exponentiation, Montgomery multiplication for odd moduli;
+// the result is in [0, |m1|)
+BigInt powmod(const BigInt &x1, const BigInt &e, const BigInt &m1)
 {
-    BigInt res = *this;
-    vector_t t(b);
-    res.v.insert(res.v.begin(), t.begin(), t.end());
+    BRIGHT_STAT(statPowmod, m1.vector_size());
+    if (m1.v.empty())
+        throw std::invalid_argument("division by zero");
+    if (e.sign < 0)
+        throw std::invalid_argument("negative exponent");
+    const unsigned int lb = BigInt::limb_bits;
+    BigInt m = m1.abs();
+    BigInt x = x1 % m;
+    if (x.sign < 0) x += m;
+    if (m.vector_size() == 1 && m.v[0] == 1)
+        return BigInt();
+    size_t ebits = e.size();
+    auto bit = [&](size_t i) { return static_cast<unsigned int>(e.v[i / lb] >> (i % lb)) & 1u; };
+
+    if (!(m.v[0] & 1)) {
+        // even modulus, plain square-and-multiply
+        Barrett ctx(m);
+        BigInt res = 1;
+        for (size_t i = ebits - 1; i < ebits; --i) {
+            res = ctx.mulmod(res, res);
+            if (bit(i)) res = ctx.mulmod(res, x);
+        }
+        return res;
+    }
+    if (ebits == 0)
+        return BigInt(1);
+
+    size_t n = m.vector_size();
+    limb_t minv = montInverse(m.v[0]);
+    unsigned int w = ebits > 671 ? 6 : ebits > 239 ? 5 : ebits > 79 ? 4 : ebits > 23 ? 3 : ebits > 6 ? 2 : 1;
+
+    // odd powers x, x^3, ..., x^(2^w - 1) in Montgomery form, n limbs each
+    vector<limb_t> table(n << (w - 1)), x2(n), acc(n), t(2 * n);
+    x._shl(n * lb);
+    x = x % m;
+    std::copy(x.v.data(), x.v.data() + x.vector_size(), table.data());
+    if (w > 1) {
+        montMul(x2.data(), table.data(), table.data(), m.v.data(), n, minv, t.data());
+        for (size_t k = 1; k < (static_cast<size_t>(1) << (w - 1)); ++k)
+            montMul(table.data() + k * n, table.data() + (k - 1) * n, x2.data(), m.v.data(), n, minv, t.data());
+    }
+
+    // scan from the top, a window ends at its lowest set bit
+    bool started = false;
+    for (size_t i = ebits - 1; i < ebits; ) {
+        if (!bit(i)) {
+            montMul(acc.data(), acc.data(), acc.data(), m.v.data(), n, minv, t.data());
+            --i;
+            continue;
+        }
+        size_t j = i + 1 >= w ? i + 1 - w : 0;
+        while (!bit(j)) ++j;
+        size_t val = 0;
+        for (size_t k = i + 1; k-- > j; )
+            val = val * 2 + bit(k);
+        const limb_t *p = table.data() + (val >> 1) * n;
+        if (started) {
+            for (size_t k = j; k <= i; ++k)
+                montMul(acc.data(), acc.data(), acc.data(), m.v.data(), n, minv, t.data());
+            montMul(acc.data(), acc.data(), p, m.v.data(), n, minv, t.data());
+        } else {
+            std::copy(p, p + n, acc.data());
+            started = true;
+        }
+        i = j - 1;
+    }
+
+    // out of Montgomery form
+    BigInt res;
+    res.v.resize(n);
+    std::copy(acc.begin(), acc.end(), t.begin());
+    std::fill(t.begin() + static_cast<long long>(n), t.end(), 0);
+    montRedc(res.v.data(), t.data(), m.v.data(), n, minv);
+    res.trim();
     return res;
 }
 
-BigInt &BigInt::operator+=(const BigInt &b)
+// the product of xs[0, n), halves multiplied separately so both operands of
+// each multiplication have about the same size
+BigInt BigInt::_product(const BigInt *xs, size_t n)
 {
-    *this = *this + b;
-    return *this;
+    if (n <= 2)
+        return n == 0 ? BigInt(1) : n == 1 ? xs[0] : xs[0] * xs[1];
+    size_t h = n / 2, limbs = 0;
+    if (threads != 1) {
+        for (size_t i = 0; i < n; ++i)
+            limbs += xs[i].vector_size();
+    }
+    BigInt lo, hi;
+    TaskGroup group(parallelFor(limbs / 2));
+    group.run([&] { lo = _product(xs, h); });
+    hi = _product(xs + h, n - h);
+    group.wait();
+    return lo * hi;
 }
 
-BigInt &BigInt::operator-=(const BigInt &b)
+BigInt product(const vector<BigInt> &xs)
 {
-    *this = *this - b;
-    return *this;
+    return BigInt::_product(xs.data(), xs.size());
 }
 
-BigInt &BigInt::operator*=(int b)
+// one pass over the limbs of all terms: each column is added up in a double
+// limb and the carries are resolved once at the end, positive and negative
+// terms separately
+BigInt sum(const vector<BigInt> &xs)
 {
-    BigInt& res = *this;
-    if (b < 0) {
-        res.sign *= -1;
-        b = -b;
+    size_t n = 0;
+    for (const BigInt &x : xs)
+        n = std::max(n, x.vector_size());
+    BRIGHT_STAT(statAdd, n);
+    vector<dlimb_t> pos(n), neg;
+    for (const BigInt &x : xs) {
+        if (x.sign < 0 && neg.empty())
+            neg.resize(n);
+        vector<dlimb_t> &col = x.sign < 0 ? neg : pos;
+        const limb_t *p = x.v.data();
+        for (size_t i = 0, m = x.vector_size(); i < m; ++i)
+            col[i] += p[i];
     }
-    if (b == base) {
-        res.v.insert(res.v.begin(), 0);
+
+    // a column holds less than count * 2^limb_bits, so the carry out of the
+    // top one fits in a single extra limb
+    auto resolve = [n](const vector<dlimb_t> &col) {
+        BigInt res;
+        res.v.resize(n + 1);
+        dlimb_t carry = 0;
+        for (size_t i = 0; i < n; ++i) {
+            carry += col[i];
+            res.v[i] = static_cast<limb_t>(carry);
+            carry >>= limbBits;
+        }
+        res.v[n] = static_cast<limb_t>(carry);
+        res.trim();
         return res;
-    }
-    unsigned long long carry = 0;
-    for (size_t i = 0; i < res.vector_size() || carry; ++i) {
-        if (i == vector_size()) res.v.push_back(0);
-        unsigned long long cur
-            = static_cast<unsigned long long>(b) * res.v[i] + carry;
-        carry = cur / base;
-        res.v[i] = cur % base;
-    }
-    res.trim();
-    return res;
+    };
+    return neg.empty() ? resolve(pos) : resolve(pos) - resolve(neg);
 }
 
-BigInt &BigInt::operator*=(const BigInt &b)
+// x % m for every m in moduli, same signs as operator%. The moduli are
+// multiplied up a product tree and x is reduced down it, so each division
+// is by a node about half the size of the one above
+vector<BigInt> remainderTree(const BigInt &x, const vector<BigInt> &moduli)
 {
-    *this = *this * b;
-    return *this;
+    if (moduli.empty())
+        return vector<BigInt>();
+    // tree[0] pairs up the moduli, tree.back() is the product of them all
+    vector<vector<BigInt>> tree;
+    const vector<BigInt> *below = &moduli;
+    while (below->size() > 1) {
+        vector<BigInt> up((below->size() + 1) / 2);
+        for (size_t i = 0; i < up.size(); ++i)
+            up[i] = 2 * i + 1 < below->size() ? (*below)[2 * i] * (*below)[2 * i + 1] : (*below)[2 * i];
+        tree.push_back(std::move(up));
+        below = &tree.back();
+    }
+
+    vector<BigInt> rem(1, x % (*below)[0]);
+    for (size_t l = tree.size(); l-- > 0; ) {
+        const vector<BigInt> &level = l ? tree[l - 1] : moduli;
+        vector<BigInt> next(level.size());
+        for (size_t i = 0; i < level.size(); ++i)
+            next[i] = rem[i / 2] % level[i];
+        rem = std::move(next);
+    }
+    return rem;
 }
 
-BigInt &BigInt::operator/=(int b)
+// the product of small factors: as many as fit are multiplied into each
+// limb first, then the limbs go through the balanced product tree
+BigInt BigInt::_productOfWords(const vector<limb_t> &fs)
 {
-    *this = *this / b;
-    return *this;
+    vector<BigInt> packed;
+    limb_t acc = 1;
+    for (limb_t f : fs) {
+        if (acc > ~static_cast<limb_t>(0) / f) {
+            packed.emplace_back();
+            packed.back().v.push_back(acc);
+            acc = f;
+        } else {
+            acc *= f;
+        }
+    }
+    packed.emplace_back();
+    packed.back().v.push_back(acc);
+    return _product(packed.data(), packed.size());
 }
 
-BigInt &BigInt::operator/=(const BigInt &b)
+// the odd part of n!, by n! = (n/2)!^2 * swing(n): p divides the swing
+// floor(n / p^i) & 1 times summed over i
+BigInt BigInt::_oddFactorial(unsigned int n, const vector<unsigned int> &primes)
 {
-    *this = *this / b;
-    return *this;
+    if (n < 3)
+        return 1;
+    BigInt half = _oddFactorial(n / 2, primes);
+    vector<limb_t> fs;
+    for (size_t i = 1; i < primes.size() && primes[i] <= n; ++i) {
+        unsigned long long p = primes[i];
+        for (unsigned long long q = n / p; q; q /= p) {
+            if (q & 1)
+                fs.push_back(static_cast<limb_t>(p));
+        }
+    }
+    return half * half * _productOfWords(fs);
 }
 
-BigInt &BigInt::operator%=(const BigInt &b)
+// n! as an odd factorial shifted by the n - popcount(n) factors of two
+BigInt BigInt::factorial(unsigned int n)
 {
-    *this = *this % b;
-    return *this;
+    BigInt res = _oddFactorial(n, primesUpTo(n));
+    return res << (n - static_cast<unsigned int>(popcountLimb(n)));
 }
 
-BigInt &BigInt::operator<<=(const unsigned int &b)
+// n choose k, 0 when k > n. By Legendre, p divides it
+// floor(n / p^i) - floor(k / p^i) - floor((n - k) / p^i) times summed over i
+BigInt BigInt::binomial(unsigned int n, unsigned int k)
 {
-    *this = *this << b;
-    return *this;
+    if (k > n)
+        return BigInt();
+    k = std::min(k, n - k);
+    vector<limb_t> fs;
+    for (unsigned int p : primesUpTo(n)) {
+        // the primes above n - k all divide it once, the ones in (n / 2, n - k] not at all
+        if (p > n - k) {
+            fs.push_back(p);
+            continue;
+        }
+        if (p > n / 2)
+            continue;
+        for (unsigned long long q = p; q <= n; q *= p) {
+            if (n / q - k / q - (n - k) / q)
+                fs.push_back(p);
+        }
+    }
+    return _productOfWords(fs);
 }
 
-BigInt &BigInt::operator>>=(const unsigned int &b)
+// the product of the primes up to n
+BigInt BigInt::primorial(unsigned int n)
 {
-    *this = *this >> b;
-    return *this;
+    vector<unsigned int> primes = primesUpTo(n);
+    return _productOfWords(vector<limb_t>(primes.begin(), primes.end()));
 }
 
-unsigned int BigInt::shift()
+Barrett::Barrett(const BigInt &m1) : m(m1.abs()), n(m1.vector_size())
 {
-    if (v.empty()) return 0u;
-    unsigned int i = static_cast<unsigned int>(v.front());
-    v.erase(v.begin());
-    return i;
+    if (m.v.empty())
+        throw std::invalid_argument("division by zero");
+    mu = BigInt(1)._shl(2 * n * BigInt::limb_bits) / m;
 }
 
-BigInt &BigInt::unshift(unsigned int b)
+const BigInt &Barrett::modulus() const
 {
-    v.insert(v.begin(), b & mask);
-    return *this;
+    return m;
 }
 
-
-bool BigInt::operator<(const BigInt &b) const
+// HAC 14.42 on limbs: the quotient estimate is at most three too small; up to
+// a few times the Karatsuba threshold, half products beat full fast ones
+BigInt Barrett::reduce(const BigInt &x) const
 {
-    if (sign != b.sign)
-        return sign < b.sign;
-    if (vector_size() != b.vector_size()) {
-        return sign > 0
-            ? vector_size() < b.vector_size()
-            : vector_size() > b.vector_size();
+    if (x.sign < 0 || x.vector_size() > 2 * n) {
+        BigInt r = x % m;
+        if (r.sign < 0) r += m;
+        return r;
     }
-    for (size_t i = vector_size() - 1; i < vector_size(); i--) {
-        if (v[i] != b.v[i]) {
-            return sign > 0
-                ? v[i] < b.v[i]
-                : v[i] > b.v[i];
-        }
+    size_t xn = x.vector_size();
+    if (cmpLimbs(x.v.data(), xn, m.v.data(), n) < 0)
+        return x;
+
+    // q = ((x >> (n - 1) limbs) * mu) >> (n + 1) limbs
+    const limb_t *q1 = x.v.data() + n - 1;
+    size_t q1n = xn - (n - 1), mun = mu.vector_size();
+    BigInt::limb_vector q2(q1n + mun);
+    bool shortProducts = n + 1 < 4 * kThreshold();
+    if (shortProducts)
+        mulHigh(q2.data(), q1, q1n, mu.v.data(), mun, n - 1);
+    else
+        mulLimbs(q2.data(), q1, q1n, mu.v.data(), mun);
+    const limb_t *q = q2.data() + n + 1;
+    size_t qn = normLen(q, q1n + mun - (n + 1));
+
+    // r = (x - q * m) mod B^(n + 1)
+    BigInt r;
+    r.v.resize(n + 1);
+    if (shortProducts || !qn) {
+        mulLow(r.v.data(), q, qn, m.v.data(), n, n + 1);
+    } else {
+        BigInt::limb_vector t(qn + n);
+        mulLimbs(t.data(), q, qn, m.v.data(), n);
+        std::copy(t.data(), t.data() + std::min(qn + n, n + 1), r.v.data());
     }
-    return false;
+    BigInt::limb_vector xl(n + 1);
+    std::copy(x.v.data(), x.v.data() + std::min(xn, n + 1), xl.data());
+    subLimbs(r.v.data(), xl.data(), n + 1, r.v.data(), n + 1);
+    while (cmpLimbs(r.v.data(), n + 1, m.v.data(), n) >= 0)
+        subLimbs(r.v.data(), r.v.data(), n + 1, m.v.data(), n);
+    r.trim();
+    return r;
 }
 
-bool BigInt::operator>(const BigInt &b) const
+BigInt Barrett::mulmod(const BigInt &a, const BigInt &b) const
 {
-    return b < *this;
+    return reduce(a * b);
 }
 
-bool BigInt::operator<=(const BigInt &b) const
+BigInt Barrett::addmod(const BigInt &a, const BigInt &b) const
 {
-    return !(b < *this);
+    BigInt r = a + b;
+    if (r >= m) r -= m;
+    return r.sign < 0 || r >= m ? reduce(r) : r;
 }
 
-bool BigInt::operator>=(const BigInt &b) const
+BigInt Barrett::submod(const BigInt &a, const BigInt &b) const
 {
-    return !(*this < b);
+    BigInt r = a - b;
+    if (r.sign < 0) r += m;
+    return r.sign < 0 || r >= m ? reduce(r) : r;
 }
 
-bool BigInt::operator==(const BigInt &b) const
+BigInt::MemoryResource::~MemoryResource()
 {
-    if (sign != b.sign) return false;
-    if (vector_size() != b.vector_size())
-        return false;
-    for (size_t i = vector_size() - 1; i < vector_size(); i--)
-        if (v[i] != b.v[i])
-            return false;
-    return true;
-}
 
-bool BigInt::operator!=(const BigInt &b) const
-{
-    return !(*this == b);
 }
 
-BigInt BigInt::operator-() const
+BigInt::MemoryResource *BigInt::setResource(MemoryResource *r)
 {
-    BigInt res = *this;
-    res.sign = -sign;
-    return res;
+    MemoryResource *previous = currentResource;
+    currentResource = r;
+    return previous;
 }
 
-BigInt BigInt::abs() const
+BigInt::ResourceScope::ResourceScope(MemoryResource &r) : previous(setResource(&r))
 {
-    BigInt res = *this;
-    res.sign = 1;
-    return res;
+
 }
 
-BigInt &BigInt::trim()
+BigInt::ResourceScope::~ResourceScope()
 {
-    while (!v.empty() && !v.back()) v.pop_back();
-    if (v.empty()) sign = 1;
-    return *this;
+    setResource(previous);
 }
 
-size_t BigInt::size() const
+BigInt::Arena::Arena(size_t blockBytes) : cur(nullptr), left(0), blockBytes(blockBytes), total(0)
 {
-    if (v.empty()) return 0;
-    size_t b = 0;
-    auto i = static_cast<unsigned int>(v.back());
-    while (i != 0) {
-        b++;
-        i >>= 1;
-    }
-    return (v.size() - 1) * base2 + b;
+
 }
 
-inline size_t BigInt::vector_size() const
+BigInt::Arena::~Arena()
 {
-    return this->v.size();
+    release();
 }
 
-BigInt BigInt::fromStr(const string &s, int _base)
+// requests larger than a block get a block of their own
+void *BigInt::Arena::allocate(size_t bytes)
 {
-    BigInt res;
-    size_t pos = 0;
-    while (pos != s.size() && (s[pos] == '-' || s[pos] == '+')) {
-        if (s[pos] == '-')
-            res.sign = -res.sign;
-        ++pos;
-    }
-    if (_base == 10) {
-        res.v = _fromBase10Str(s.substr(pos));
-        return res;
+    const size_t align = alignof(std::max_align_t);
+    bytes = (bytes + align - 1) / align * align;
+    if (bytes > left) {
+        size_t size = std::max(bytes, blockBytes);
+        blocks.push_back(static_cast<char *>(::operator new(size)));
+        cur = blocks.back();
+        left = size;
     }
-    if (_base == 2) {
-        res.v = _fromBase2Str(s.substr(pos));
-        return res;
-    }
-    string temp;
-    if (_base == 16) {
-        for (; pos != s.size(); ++pos) {
-            switch (s[pos]) {
-            case '0': temp += "0000"; break;
-            case '1': temp += "0001"; break;
-            case '2': temp += "0010"; break;
-            case '3': temp += "0011"; break;
-            case '4': temp += "0100"; break;
-            case '5': temp += "0101"; break;
-            case '6': temp += "0110"; break;
-            case '7': temp += "0111"; break;
-            case '8': temp += "1000"; break;
-            case '9': temp += "1001"; break;
-            case 'A': temp += "1010"; break;
-            case 'B': temp += "1011"; break;
-            case 'C': temp += "1100"; break;
-            case 'D': temp += "1101"; break;
-            case 'E': temp += "1110"; break;
-            case 'F': temp += "1111"; break;
-            default: temp += s[pos]; break;
-            }
-        }
-    }
-    else if (_base == 8) {
-        for (; pos != s.size(); ++pos) {
-            switch (s[pos]) {
-            case '0': temp += "000"; break;
-            case '1': temp += "001"; break;
-            case '2': temp += "010"; break;
-            case '3': temp += "011"; break;
-            case '4': temp += "100"; break;
-            case '5': temp += "101"; break;
-            case '6': temp += "110"; break;
-            case '7': temp += "111"; break;
-            default: temp += s[pos]; break;
-            }
-        }
-    }
-    res.v = _fromBase2Str(temp);
+    void *res = cur;
+    cur += bytes;
+    left -= bytes;
+    total += bytes;
     return res;
 }
 
-string BigInt::toStr(int _base) const
+void BigInt::Arena::deallocate(void *, size_t)
 {
-    if (vector_size() == 0) return "0";
-    string _sign = this->sign == 1 ? "" : "-";
 
-    if (_base == 10) {
-        string res;
-        BigInt a = *this, b;
-        a.sign = 1;
-        while (a != 0) {
-            auto t = divmod(a, 10);
-            a = t.first;
-            res += '0' + static_cast<char>(t.second.shift());
-        }
-        std::reverse(res.begin(), res.end());
-        return _sign + res;
-    }
+}
+
+// every value allocated here must be gone by now
+void BigInt::Arena::release()
+{
+    for (char *b : blocks)
+        ::operator delete(b);
+    blocks.clear();
+    cur = nullptr;
+    left = 0;
+    total = 0;
+}
 
-    string base2str;
+size_t BigInt::Arena::used() const
+{
+    return total;
+}
 
-    for (auto i = v.rbegin(); i != v.rend(); ++i) {
-        base2str += bitset<base2>(*i).to_string();
-    }
+BigInt::Pool::Pool()
+{
+    std::fill(freeList, freeList + classes, nullptr);
+}
 
-    size_t _begin = 0;
-    while (base2str[_begin] == '0') _begin++;
-    base2str.erase(0, _begin);
+BigInt::Pool::~Pool()
+{
+    for (char *s : slabs)
+        ::operator delete(s);
+}
 
-    if (_base == 2)
-        return _sign + base2str;
+namespace {
 
-    string res;
-    unsigned int b = 0;
-    unsigned short temp = 0;
+// class c holds blocks of 64 << c bytes, -1 when bytes is above them all
+int poolClass(size_t bytes, int classes)
+{
+    int c = 0;
+    while (c < classes && (static_cast<size_t>(64) << c) < bytes)
+        ++c;
+    return c < classes ? c : -1;
+}
 
-    if (_base == 16) {
-        for (auto i = base2str.rbegin(); i != base2str.rend(); ++i) {
-            switch (*i) {
-            case '0': break;
-            case '1': temp += 1 << b; break;
-            }
-            ++b;
-            if (b == 4) {
-                res += _base16ToChar(temp);
-                temp = 0;
-                b = 0;
-            }
-        }
-        if (temp != 0)
-            res += _base16ToChar(temp);
-    }
-    else if (_base == 8) {
-        for (auto i = base2str.rbegin(); i != base2str.rend(); ++i) {
-            switch (*i) {
-            case '0': break;
-            case '1': temp += 1 << b; break;
-            }
-            ++b;
-            if (b == 3) {
-                res += _base8ToChar(temp);
-                temp = 0;
-                b = 0;
-            }
+} // namespace
+
+// an empty class takes a slab of at least 64KiB and threads it into its list
+void *BigInt::Pool::allocate(size_t bytes)
+{
+    int c = poolClass(bytes, classes);
+    if (c < 0)
+        return ::operator new(bytes);
+    if (!freeList[c]) {
+        size_t size = static_cast<size_t>(64) << c, count = std::max<size_t>(1, 65536 / size);
+        char *slab = static_cast<char *>(::operator new(size * count));
+        slabs.push_back(slab);
+        for (size_t i = count; i-- > 0; ) {
+            *reinterpret_cast<void **>(slab + i * size) = freeList[c];
+            freeList[c] = slab + i * size;
         }
-        if (temp != 0)
-            res += _base8ToChar(temp);
     }
-    std::reverse(res.begin(), res.end());
-    return _sign + res;
+    void *res = freeList[c];
+    freeList[c] = *static_cast<void **>(res);
+    return res;
 }
 
-BigInt::vector_t BigInt::_fromBase2Str(const string &s)
+void BigInt::Pool::deallocate(void *p, size_t bytes)
 {
-    vector_t v;
-    unsigned int b = 0;
-    unsigned int temp = 0;
-    for (auto i = s.rbegin(); i != s.rend(); ++i) {
-        switch (*i) {
-        case '0': break;
-        case '1': temp += 1 << b; break;
-        default:
-            throw std::invalid_argument("wrong base");
-        }
-        ++b;
-        if (b == base2) {
-            v.push_back(temp);
-            temp = 0;
-            b = 0;
-        }
+    int c = poolClass(bytes, classes);
+    if (c < 0) {
+        ::operator delete(p);
+        return;
     }
-    if (temp != 0)
-        v.push_back(temp);
-    return v;
+    *static_cast<void **>(p) = freeList[c];
+    freeList[c] = p;
 }
 
-BigInt::vector_t BigInt::_fromBase10Str(const string &s)
+const char *BigInt::simdKernel()
 {
-    BigInt tmp;
-    for (auto i = s.begin(); i != s.end(); i++) {
-        int what = (*i - '0');
-        if (what < 0 || what > 9)
-            throw std::invalid_argument("wrong base");
-        tmp = tmp * 10 + what;
-    }
-    return tmp.v;
+    return carryKernels().name;
 }
 
-inline char BigInt::_base16ToChar(unsigned short t)
+const char *BigInt::statName(StatOp op)
 {
-    switch (t) {
-    case 0: return '0';
-    case 1: return '1';
-    case 2: return '2';
-    case 3: return '3';
-    case 4: return '4';
-    case 5: return '5';
-    case 6: return '6';
-    case 7: return '7';
-    case 8: return '8';
-    case 9: return '9';
-    case 10: return 'A';
-    case 11: return 'B';
-    case 12: return 'C';
-    case 13: return 'D';
-    case 14: return 'E';
-    case 15: return 'F';
-    }
-    throw std::invalid_argument("wrong base");
+    return op < statOpCount ? statNames[op] : "";
 }
 
-inline char BigInt::_base8ToChar(unsigned short t)
+BigInt::Stats BigInt::stats()
 {
-    switch (t) {
-    case 0: return '0';
-    case 1: return '1';
-    case 2: return '2';
-    case 3: return '3';
-    case 4: return '4';
-    case 5: return '5';
-    case 6: return '6';
-    case 7: return '7';
+    Stats res = Stats();
+#if BRIGHT_STATS
+    for (int i = 0; i < statOpCount; ++i) {
+        res.ops[i].calls = statCounters.calls[i].load(std::memory_order_relaxed);
+        res.ops[i].limbs = statCounters.limbs[i].load(std::memory_order_relaxed);
+        res.ops[i].nanoseconds = statCounters.nanoseconds[i].load(std::memory_order_relaxed);
     }
-    throw std::invalid_argument("wrong base");
+    res.allocations = statCounters.allocations.load(std::memory_order_relaxed);
+    res.frees = statCounters.frees.load(std::memory_order_relaxed);
+    res.bytes = statCounters.bytes.load(std::memory_order_relaxed);
+    res.liveBytes = statCounters.liveBytes.load(std::memory_order_relaxed);
+    res.peakBytes = statCounters.peakBytes.load(std::memory_order_relaxed);
+#endif
+    return res;
 }
 
-std::pair<BigInt, BigInt> divmod(const BigInt &a1, const BigInt &b1) {
-    unsigned int norm = BigInt::base / static_cast<unsigned int>(b1.v.back() + 1);
-    BigInt a = a1.abs() * norm;
-    BigInt b = b1.abs() * norm;
-    BigInt q, r;
-    q.v.resize(a.vector_size());
-
-    for (size_t i = a.vector_size() - 1; i < a.vector_size(); i--) {
-        r *= BigInt::base;
-        r += static_cast<unsigned int>(a.v[i]);
-        unsigned int s1 = r.vector_size() <= b.vector_size() ? 0 : static_cast<unsigned int>(r.v[b.vector_size()]);
-        unsigned int s2 = r.vector_size() <= b.vector_size() - 1 ? 0 : static_cast<unsigned int>(r.v[b.vector_size() - 1]);
-        long long d = (static_cast<unsigned long long>(BigInt::base) * s1 + s2) / b.v.back();
-        r -= b * BigInt(d);
-        while (r < 0) {
-            r += b;
-            --d;
-        }
-        q.v[i] = static_cast<unsigned int>(d);
+// live bytes are kept, they describe memory still held; the peak restarts there
+void BigInt::resetStats()
+{
+#if BRIGHT_STATS
+    for (int i = 0; i < statOpCount; ++i) {
+        statCounters.calls[i].store(0, std::memory_order_relaxed);
+        statCounters.limbs[i].store(0, std::memory_order_relaxed);
+        statCounters.nanoseconds[i].store(0, std::memory_order_relaxed);
     }
+    statCounters.allocations.store(0, std::memory_order_relaxed);
+    statCounters.frees.store(0, std::memory_order_relaxed);
+    statCounters.bytes.store(0, std::memory_order_relaxed);
+    statCounters.peakBytes.store(statCounters.liveBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+#endif
+}
 
-    q.sign = a1.sign * b1.sign;
-    r.sign = a1.sign;
-    q.trim();
-    r.trim();
-    return make_pair(q, r / norm);
+// one line per operation that was called, then the heap counters
+void BigInt::dumpStats(ostream &os)
+{
+#if BRIGHT_STATS
+    Stats st = stats();
+    os << std::left << std::setw(10) << "op" << std::right << std::setw(14) << "calls"
+       << std::setw(16) << "limbs" << std::setw(16) << "ns" << std::setw(12) << "ns/call" << '\n';
+    for (int i = 0; i < statOpCount; ++i) {
+        const OpStats &o = st.ops[i];
+        if (!o.calls) continue;
+        os << std::left << std::setw(10) << statNames[i] << std::right << std::setw(14) << o.calls
+           << std::setw(16) << o.limbs << std::setw(16) << o.nanoseconds
+           << std::setw(12) << o.nanoseconds / o.calls << '\n';
+    }
+    os << "allocations " << st.allocations << ", frees " << st.frees << ", bytes " << st.bytes
+       << ", live " << st.liveBytes << ", peak " << st.peakBytes << '\n';
+#else
+    os << "statistics disabled, build with -DBRIGHT_STATS=1\n";
+#endif
 }
 
+// digits go out in blocks as they are produced; a field width needs the
+// whole string for padding and takes the toStr path
 ostream &operator<<(ostream &os, const BigInt &b)
 {
     int base = 10;
@@ -574,14 +3361,44 @@ ostream &operator<<(ostream &os, const BigInt &b)
     else if (os.flags() & std::ios::oct) {
         base = 8;
     }
-    os << b.toStr(base);
+    if (os.width() > 0 || b.v.empty()) {
+        os << b.toStr(base);
+        return os;
+    }
+    BRIGHT_STAT(statToStr, b.vector_size());
+    ostream::sentry guard(os);
+    if (!guard)
+        return os;
+    string buf;
+    buf.reserve(streamBlock + 64);
+    if (b.sign < 0)
+        buf += '-';
+    if (base == 10) {
+        BigInt::_toBase10Str(b.abs(), 0, buf, &os);
+    } else {
+        unsigned int bits = base == 16 ? 4 : 3;
+        for (size_t j = (b.size() + bits - 1) / bits; j-- > 0; ) {
+            size_t at = j * bits, i = at / BigInt::limb_bits;
+            unsigned int off = at % BigInt::limb_bits;
+            limb_t d = b.v[i] >> off;
+            if (off + bits > BigInt::limb_bits && i + 1 < b.vector_size())
+                d |= b.v[i + 1] << (BigInt::limb_bits - off);
+            buf += radixDigits[d & ((1u << bits) - 1)];
+            if (buf.size() >= streamBlock) {
+                os.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+                buf.clear();
+            }
+        }
+    }
+    os.write(buf.data(), static_cast<std::streamsize>(buf.size()));
     return os;
 }
 
+// reads an optional sign and the longest run of digits that follows, like
+// the built-in integers; failbit is set and b kept when there is no digit.
+// Digits are packed as they arrive, never held as text
 istream &operator>>(istream &is, BigInt &b)
 {
-    string str;
-    is >> str;
     int _base = 10;
     if (is.flags() & std::ios::hex) {
         _base = 16;
@@ -589,6 +3406,109 @@ istream &operator>>(istream &is, BigInt &b)
     else if (is.flags() & std::ios::oct) {
         _base = 8;
     }
-    b = BigInt::fromStr(str, _base);
+    BRIGHT_STAT(statFromStr, 0);
+    istream::sentry guard(is);
+    if (!guard)
+        return is;
+    std::streambuf *sb = is.rdbuf();
+    typedef std::char_traits<char> traits;
+    int c = sb->sgetc();
+    int sign = 1;
+    if (c == '-' || c == '+') {
+        sign = c == '-' ? -1 : 1;
+        c = sb->snextc();
+    }
+    auto digit = [&](int ch) {
+        int d = ch == traits::eof() ? -1 : digitValue[static_cast<unsigned char>(ch)];
+        return d < _base ? d : -1;
+    };
+    if (_base == 16 && c == '0') {
+        c = sb->snextc();
+        if (c == 'x' || c == 'X')
+            c = sb->snextc();
+        else if (digit(c) < 0) {
+            b = BigInt();
+            if (c == traits::eof()) is.setstate(std::ios::eofbit);
+            return is;
+        }
+    }
+
+    BigInt res;
+    size_t count = 0;
+    if (_base == 10) {
+        // full blocks merge pairwise like a binary counter, so the stack holds
+        // blocks of decreasing length and about the size of the value in all
+        const size_t blockDigits = decChunkDigits << streamBlockLog;
+        vector<std::pair<BigInt, size_t>> stack;
+        string block;
+        block.reserve(blockDigits);
+        for (; digit(c) >= 0; c = sb->snextc()) {
+            block += static_cast<char>(c);
+            ++count;
+            if (block.size() < blockDigits)
+                continue;
+            stack.emplace_back(BigInt::_fromBase10Range(block.data(), block.data() + block.size()), 0);
+            block.clear();
+            while (stack.size() >= 2 && stack[stack.size() - 2].second == stack.back().second) {
+                std::pair<BigInt, size_t> lo = std::move(stack.back());
+                stack.pop_back();
+                stack.back().first = stack.back().first * BigInt::_pow10(streamBlockLog + lo.second) + lo.first;
+                ++stack.back().second;
+            }
+        }
+        res = BigInt::_fromBase10Range(block.data(), block.data() + block.size());
+        BigInt scale = BigInt::_pow(BigInt(10), static_cast<unsigned int>(block.size()));
+        for (size_t i = stack.size(); i-- > 0; ) {
+            res += stack[i].first * scale;
+            if (i) scale *= BigInt::_pow10(streamBlockLog + stack[i].second);
+        }
+    } else {
+        // words of whole digits go straight into res.v, most significant
+        // first; once the digit count is known they are reversed in place and
+        // repacked into limbs from the bottom, the partial last word first
+        unsigned int bits = _base == 16 ? 4 : 3, per = BigInt::limb_bits / bits;
+        unsigned int wordBits = per * bits;
+        limb_t cur = 0;
+        unsigned int curDigits = 0;
+        for (int d; (d = digit(c)) >= 0; c = sb->snextc()) {
+            cur = (cur << bits) | static_cast<limb_t>(d);
+            ++count;
+            if (++curDigits == per) {
+                res.v.push_back(cur);
+                cur = 0;
+                curDigits = 0;
+            }
+        }
+        limb_t *w = res.v.data();
+        size_t m = res.vector_size(), o = 0;
+        std::reverse(w, w + m);
+        dlimb_t acc = cur;
+        unsigned int accBits = curDigits * bits;
+        for (size_t j = 0; j < m; ++j) {
+            acc |= static_cast<dlimb_t>(w[j]) << accBits;
+            accBits += wordBits;
+            // fewer bits are emitted than read, so o <= j never passes a
+            // word still to be read
+            if (accBits >= BigInt::limb_bits) {
+                w[o++] = static_cast<limb_t>(acc);
+                acc >>= BigInt::limb_bits;
+                accBits -= BigInt::limb_bits;
+            }
+        }
+        res.v.resize(o);
+        if (accBits)
+            res.v.push_back(static_cast<limb_t>(acc));
+        res.trim();
+    }
+
+    if (c == traits::eof())
+        is.setstate(std::ios::eofbit);
+    if (!count) {
+        is.setstate(std::ios::failbit);
+        return is;
+    }
+    res.sign = res.v.empty() ? 1 : sign;
+    BRIGHT_STAT_LIMBS(res.vector_size());
+    b = std::move(res);
     return is;
 }
@@ -17,38 +17,249 @@
 #include <bitset>
 #include <sstream>
 #include <iomanip>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+// limbs are full machine words: 64-bit where the compiler has unsigned __int128
+// for double-width products, 32-bit otherwise
+#ifndef BRIGHT_LIMB_BITS
+#ifdef __SIZEOF_INT128__
+#define BRIGHT_LIMB_BITS 64
+#else
+#define BRIGHT_LIMB_BITS 32
+#endif
+#endif
+
+// multiplication algorithm thresholds, in limbs of the shorter operand
+#ifndef BRIGHT_KARATSUBA_THRESHOLD
+#define BRIGHT_KARATSUBA_THRESHOLD 32
+#endif
+#ifndef BRIGHT_TOOM3_THRESHOLD
+#define BRIGHT_TOOM3_THRESHOLD 192
+#endif
+#ifndef BRIGHT_NTT_THRESHOLD
+#if BRIGHT_LIMB_BITS == 64
+#define BRIGHT_NTT_THRESHOLD 65536
+#else
+#define BRIGHT_NTT_THRESHOLD 8192
+#endif
+#endif
+
+// division switches from schoolbook to Burnikel-Ziegler above this many
+// limbs in both the divisor and the quotient
+#ifndef BRIGHT_DIV_THRESHOLD
+#define BRIGHT_DIV_THRESHOLD 64
+#endif
+
+// products, divisions and decimal conversions fan out to other threads above
+// this many limbs, when BRIGHT_THREADS is not 1; 0 threads means one per core
+#ifndef BRIGHT_PARALLEL_THRESHOLD
+#define BRIGHT_PARALLEL_THRESHOLD 2048
+#endif
+#ifndef BRIGHT_THREADS
+#define BRIGHT_THREADS 1
+#endif
+
+// per-operation call counts, operand sizes and times plus heap counters for
+// the limb storage, read with BigInt::stats(); compiled out unless set to 1
+#ifndef BRIGHT_STATS
+#define BRIGHT_STATS 0
+#endif
+
+// vectorised add/sub kernels picked by CPUID at runtime (x86-64 with 64-bit
+// limbs); 0 keeps the portable loops everywhere
+#ifndef BRIGHT_SIMD
+#define BRIGHT_SIMD 1
+#endif
+
+// FixedBigInt is constexpr where the language allows loops in constexpr functions
+#if __cplusplus >= 201402L
+#define BRIGHT_CONSTEXPR constexpr
+#else
+#define BRIGHT_CONSTEXPR inline
+#endif
+
+// values up to this many limbs are stored inline, larger ones spill to the heap
+#ifndef BRIGHT_INLINE_LIMBS
+#define BRIGHT_INLINE_LIMBS 4
+#endif
 
 using namespace std;
 
 class BigInt {
+public:
+#if BRIGHT_LIMB_BITS == 64
+    typedef unsigned long long limb_t;
+#else
+    typedef unsigned int limb_t;
+#endif
+    const static unsigned int limb_bits = BRIGHT_LIMB_BITS;
+
+private:
     typedef vector<unsigned long long> vector_t;
-    vector_t v;
+
+    // the subset of vector<limb_t> used on magnitudes, with the first
+    // BRIGHT_INLINE_LIMBS limbs kept inside the object
+    class limb_vector {
+    public:
+        limb_vector();
+        explicit limb_vector(size_t n);
+        limb_vector(const limb_vector &o);
+        limb_vector(limb_vector &&o) noexcept;
+        ~limb_vector();
+        limb_vector& operator=(const limb_vector &o);
+        limb_vector& operator=(limb_vector &&o) noexcept;
+
+        size_t size() const;
+        bool empty() const;
+        bool isInline() const;
+        limb_t* data();
+        const limb_t* data() const;
+        limb_t* begin();
+        limb_t* end();
+        limb_t& operator[](size_t i);
+        const limb_t& operator[](size_t i) const;
+        limb_t& front();
+        limb_t& back();
+        const limb_t& back() const;
+
+        void reserve(size_t n);
+        void resize(size_t n, limb_t value = 0);
+        void assign(size_t n, limb_t value);
+        void clear();
+        void push_back(limb_t x);
+        void pop_back();
+        limb_t* insert(limb_t *pos, size_t count, limb_t value);
+        limb_t* insert(limb_t *pos, limb_t value);
+        limb_t* erase(limb_t *first, limb_t *last);
+
+    private:
+        limb_t *p;
+        size_t n, cap;
+        limb_t buf[BRIGHT_INLINE_LIMBS];
+    };
+
+    limb_vector v;
     int sign;
 
 public:
+    // shift(), unshift() and the vector_t constructor work in 2^30 digits
+    // regardless of the limb width
     const static unsigned int base = 0x40000000;
     const static unsigned int mask = base - 1;
     const static unsigned int base2 = 30;
 
+    // tunable at runtime, default to the BRIGHT_*_THRESHOLD macros
+    static size_t karatsubaThreshold;
+    static size_t toom3Threshold;
+    static size_t nttThreshold;
+    static size_t divThreshold;
+    static size_t parallelThreshold;
+    // set before the parallel work starts, the pool only ever grows
+    static unsigned int threads;
+
+    // where heap limb storage comes from. Each thread allocates from its
+    // current resource, new/delete unless a ResourceScope says otherwise;
+    // blocks go back to the resource they came from, which has to outlive
+    // them. Parallel tasks always use the default, also when the calling
+    // thread runs them while it waits
+    class MemoryResource {
+    public:
+        virtual ~MemoryResource();
+        virtual void *allocate(size_t bytes) = 0;
+        virtual void deallocate(void *p, size_t bytes) = 0;
+    };
+
+    // bump allocation out of large blocks, deallocate does nothing and
+    // release() (or the destructor) drops everything at once
+    class Arena : public MemoryResource {
+    public:
+        explicit Arena(size_t blockBytes = 1 << 20);
+        Arena(const Arena &) = delete;
+        Arena& operator=(const Arena &) = delete;
+        ~Arena();
+        void *allocate(size_t bytes) override;
+        void deallocate(void *p, size_t bytes) override;
+        void release();
+        size_t used() const;
+
+    private:
+        vector<char *> blocks;
+        char *cur;
+        size_t left, blockBytes, total;
+    };
+
+    // free lists of power-of-two size classes carved from shared slabs, larger
+    // requests go straight to new/delete; not safe to share between threads
+    class Pool : public MemoryResource {
+    public:
+        Pool();
+        Pool(const Pool &) = delete;
+        Pool& operator=(const Pool &) = delete;
+        ~Pool();
+        void *allocate(size_t bytes) override;
+        void deallocate(void *p, size_t bytes) override;
+
+    private:
+        static const int classes = 15;
+        void *freeList[classes];
+        vector<char *> slabs;
+    };
+
+    // makes r the current resource of this thread until destroyed
+    class ResourceScope {
+    public:
+        explicit ResourceScope(MemoryResource &r);
+        ResourceScope(const ResourceScope &) = delete;
+        ResourceScope& operator=(const ResourceScope &) = delete;
+        ~ResourceScope();
+
+    private:
+        MemoryResource *previous;
+    };
+
+    // null restores new/delete, returns the previous resource (null for the default)
+    static MemoryResource *setResource(MemoryResource *r);
+
     BigInt();
+    BigInt(const BigInt &b);
+    BigInt(BigInt &&b) noexcept;
     BigInt(const long long& v);
     BigInt(const vector_t& v);
     BigInt(const string &s, int _base = 10);
     BigInt(const char* &s, int _base = 10);
 
     BigInt& operator=(const BigInt &b);
+    BigInt& operator=(BigInt &&b) noexcept;
     BigInt& operator=(long long num);
 
-    BigInt operator+(const BigInt &b) const;
-    BigInt operator-(const BigInt &b) const;
-    BigInt operator*(int b) const;
+    // the && overloads reuse the left operand when it is a temporary
+    BigInt operator+(const BigInt &b) const &;
+    BigInt operator+(const BigInt &b) &&;
+    BigInt operator-(const BigInt &b) const &;
+    BigInt operator-(const BigInt &b) &&;
+    BigInt operator*(int b) const &;
+    BigInt operator*(int b) &&;
     BigInt operator*(const BigInt &b) const;
-    BigInt operator/(int b) const;
+    BigInt operator/(int b) const &;
+    BigInt operator/(int b) &&;
     BigInt operator/(const BigInt &b) const;
     BigInt operator%(const BigInt &b) const;
     unsigned long long operator%(unsigned long long b) const;
-    BigInt operator<<(const unsigned int &b) const;
-    BigInt operator>>(const unsigned int &b) const;
+    // shift by bits; they used to shift by 2^30 digits, so old x << n is now
+    // x << (30 * n), or unshift() digit by digit. >> rounds toward -infinity
+    BigInt operator<<(const unsigned int &b) const &;
+    BigInt operator<<(const unsigned int &b) &&;
+    BigInt operator>>(const unsigned int &b) const &;
+    BigInt operator>>(const unsigned int &b) &&;
+
+    // bitwise operators and >> treat negative values as two's complement
+    // with infinite sign extension, like the built-in integers
+    BigInt operator&(const BigInt &b) const;
+    BigInt operator|(const BigInt &b) const;
+    BigInt operator^(const BigInt &b) const;
+    BigInt operator~() const;
 
     BigInt& operator+=(const BigInt &b);
     BigInt& operator-=(const BigInt &b);
@@ -59,6 +270,14 @@ public:
     BigInt& operator%=(const BigInt &b);
     BigInt& operator<<=(const unsigned int &b);
     BigInt& operator>>=(const unsigned int &b);
+    BigInt& operator&=(const BigInt &b);
+    BigInt& operator|=(const BigInt &b);
+    BigInt& operator^=(const BigInt &b);
+
+    bool testBit(size_t i) const;
+    BigInt& setBit(size_t i, bool value = true);
+    size_t popcount() const;
+    size_t countTrailingZeros() const;
 
     unsigned int shift();
     BigInt& unshift(unsigned int b);
@@ -70,33 +289,482 @@ public:
     bool operator==(const BigInt &b) const;
     bool operator!=(const BigInt &b) const;
 
-    BigInt operator-() const;
+    BigInt operator-() const &;
+    BigInt operator-() &&;
 
-    BigInt abs() const;
+    BigInt abs() const &;
+    BigInt abs() &&;
 
     size_t size() const;
     size_t vector_size() const;
 
     static BigInt fromStr(const string &s, int _base);
+
+    // n!, n choose k and the product of the primes up to n, built from a
+    // prime sieve and balanced product trees
+    static BigInt factorial(unsigned int n);
+    static BigInt binomial(unsigned int n, unsigned int k);
+    static BigInt primorial(unsigned int n);
     string toStr(int _base) const;
 
+    // instrumented operations; times are inclusive, so divmod also counts
+    // the products it does under mul
+    enum StatOp {
+        statAdd, statMul, statMulSmall, statDivmod, statDivSmall, statShift, statBitwise,
+        statPowmod, statGcd, statRoot, statToStr, statFromStr, statTrim, statOpCount
+    };
+    struct OpStats {
+        unsigned long long calls, limbs, nanoseconds;
+    };
+    struct Stats {
+        OpStats ops[statOpCount];
+        // heap blocks of limb storage, inline values never count
+        unsigned long long allocations, frees, bytes, liveBytes, peakBytes;
+    };
+    // a snapshot, all zero when BRIGHT_STATS is 0
+    static Stats stats();
+    static void resetStats();
+    static void dumpStats(ostream &os);
+    static const char *statName(StatOp op);
+
+    // the add/sub kernels in use: "avx512", "avx2" or "scalar"
+    static const char *simdKernel();
+
+    // raw magnitude words, like mpz_import / mpz_export
+    static BigInt fromBytes(const void *src, size_t count, size_t size, int order, int endian);
+    size_t toBytes(void *dst, size_t size, int order, int endian) const;
+
+    // compact binary form with the sign, for files and buffers
+    size_t serializedSize() const;
+    size_t serialize(void *dst) const;
+    static BigInt deserialize(const void *src, size_t len);
+    void save(const string &path) const;
+    static BigInt load(const string &path);
+
 private:
     BigInt& trim();
+    BigInt& _shl(size_t bits);
+    BigInt& _shr(size_t bits);
+    BigInt& _addInPlace(const BigInt &b, int bsign);
+    BigInt _bitwise(const BigInt &b, char op) const;
+    static BigInt _gcd(const BigInt &a0, const BigInt &b0, BigInt *s);
+    static BigInt _addSigned(const BigInt &a, const BigInt &b, int bsign);
+    static BigInt _pow(const BigInt &x, unsigned int k);
+    static BigInt _iroot(const BigInt &n, unsigned int k);
+    static BigInt _product(const BigInt *xs, size_t n);
+    static BigInt _productOfWords(const vector<limb_t> &fs);
+    static BigInt _oddFactorial(unsigned int n, const vector<unsigned int> &primes);
+    double _log2() const;
 
-    static vector_t _fromBase2Str(const string &s);
-    static vector_t _fromBase10Str(const string &s);
+    BigInt _limbs(size_t from, size_t count) const;
+    static std::pair<BigInt, BigInt> _divmodBasecase(const BigInt &a, const BigInt &b);
+    static std::pair<BigInt, BigInt> _divmodRecursive(const BigInt &a, const BigInt &b);
+    static std::pair<BigInt, BigInt> _div2n1n(const BigInt &a, const BigInt &b, size_t n);
+    static std::pair<BigInt, BigInt> _div3n2n(const BigInt &a, const BigInt &b, size_t k);
 
-    static char _base16ToChar(unsigned short t);
-    static char _base8ToChar(unsigned short t);
+    static limb_vector _fromBase2kStr(const string &s, size_t pos, unsigned int bits);
+    static limb_vector _fromBase10Str(const string &s);
+
+    static const BigInt& _pow10(size_t k);
+    static BigInt _fromBase10Range(const char *first, const char *last);
+    static void _toBase10Str(const BigInt &x, size_t width, string &out, ostream *os);
+
+    string _toBase2kStr(unsigned int bits) const;
 
     // friends:
     friend std::pair<BigInt, BigInt> divmod(const BigInt &a1, const BigInt &b1);
+    friend BigInt gcd(const BigInt &a, const BigInt &b);
+    friend BigInt lcm(const BigInt &a, const BigInt &b);
+    friend BigInt gcdext(const BigInt &a, const BigInt &b, BigInt &s, BigInt &t);
+    friend BigInt modinv(const BigInt &a, const BigInt &m);
+    friend BigInt isqrt(const BigInt &a);
+    friend BigInt iroot(const BigInt &a, unsigned int k);
+    friend bool isPerfectSquare(const BigInt &a);
+    friend bool isPerfectPower(const BigInt &a);
+    friend BigInt powmod(const BigInt &x1, const BigInt &e, const BigInt &m1);
+    friend BigInt product(const vector<BigInt> &xs);
+    friend BigInt sum(const vector<BigInt> &xs);
+    friend vector<BigInt> remainderTree(const BigInt &x, const vector<BigInt> &moduli);
+    friend class Barrett;
     friend ostream &operator<<(ostream &os, const BigInt &b);
     friend istream &operator>>(istream &is, BigInt &b);
 };
 
+// repeated reduction by one modulus m: mu = B^2n / m is computed once, after
+// that each reduction of a value below B^2n costs two multiplications
+class Barrett {
+public:
+    explicit Barrett(const BigInt &m);
+
+    const BigInt& modulus() const;
+
+    // results are in [0, m), inputs may be any value
+    BigInt reduce(const BigInt &x) const;
+    BigInt mulmod(const BigInt &a, const BigInt &b) const;
+    BigInt addmod(const BigInt &a, const BigInt &b) const;
+    BigInt submod(const BigInt &a, const BigInt &b) const;
+
+private:
+    BigInt m, mu;
+    size_t n;
+};
+
+// unsigned integers of exactly Bits bits in inline limbs, arithmetic wraps
+// modulo 2^Bits like the built-in unsigned types. Bits is a multiple of the
+// limb width; everything but the BigInt conversions is constexpr under C++14
+template <unsigned int Bits>
+class FixedBigInt {
+public:
+    typedef BigInt::limb_t limb_t;
+    const static unsigned int limb_bits = BigInt::limb_bits;
+    const static size_t limbs = Bits / BigInt::limb_bits;
+    static_assert(Bits > 0 && Bits % BigInt::limb_bits == 0, "Bits must be a multiple of the limb width");
+
+private:
+#if BRIGHT_LIMB_BITS == 64
+    typedef unsigned __int128 dlimb_t;
+#else
+    typedef unsigned long long dlimb_t;
+#endif
+
+    limb_t w[limbs];
+
+    static BRIGHT_CONSTEXPR unsigned int leadingZeros(limb_t x)
+    {
+        unsigned int n = 0;
+        for (limb_t bit = static_cast<limb_t>(1) << (limb_bits - 1); bit && !(x & bit); bit >>= 1)
+            ++n;
+        return n;
+    }
+
+    static BRIGHT_CONSTEXPR int compare(const FixedBigInt &a, const FixedBigInt &b)
+    {
+        for (size_t i = limbs; i-- > 0; ) {
+            if (a.w[i] != b.w[i])
+                return a.w[i] < b.w[i] ? -1 : 1;
+        }
+        return 0;
+    }
+
+public:
+    BRIGHT_CONSTEXPR FixedBigInt() : w()
+    {
+
+    }
+
+    // any built-in integer, negative values wrap like the built-in conversions
+    template <class T, class = typename std::enable_if<std::is_integral<T>::value>::type>
+    BRIGHT_CONSTEXPR FixedBigInt(T x) : w()
+    {
+        unsigned long long u = static_cast<unsigned long long>(x);
+        limb_t fill = std::is_signed<T>::value && static_cast<long long>(x) < 0 ? ~static_cast<limb_t>(0) : 0;
+        for (size_t i = 0; i < limbs; ++i)
+            w[i] = i * limb_bits < 64 ? static_cast<limb_t>(u >> (i * limb_bits)) : fill;
+    }
+
+    // x modulo 2^Bits, negative values as two's complement
+    explicit FixedBigInt(const BigInt &x) : w()
+    {
+        BigInt m = x & ((BigInt(1) << Bits) - 1);
+        m.toBytes(w, sizeof(limb_t), -1, 0);
+    }
+
+    BigInt toBigInt() const
+    {
+        return BigInt::fromBytes(w, limbs, sizeof(limb_t), -1, 0);
+    }
+
+    BRIGHT_CONSTEXPR limb_t limb(size_t i) const
+    {
+        return w[i];
+    }
+
+    BRIGHT_CONSTEXPR explicit operator bool() const
+    {
+        for (size_t i = 0; i < limbs; ++i) {
+            if (w[i])
+                return true;
+        }
+        return false;
+    }
+
+    BRIGHT_CONSTEXPR FixedBigInt& operator+=(const FixedBigInt &b)
+    {
+        addOverflow(*this, b, *this);
+        return *this;
+    }
+
+    BRIGHT_CONSTEXPR FixedBigInt& operator-=(const FixedBigInt &b)
+    {
+        subOverflow(*this, b, *this);
+        return *this;
+    }
+
+    // only the partial products below 2^Bits
+    BRIGHT_CONSTEXPR FixedBigInt& operator*=(const FixedBigInt &b)
+    {
+        limb_t t[limbs] = {};
+        for (size_t i = 0; i < limbs; ++i) {
+            limb_t carry = 0;
+            for (size_t j = 0; i + j < limbs; ++j) {
+                dlimb_t p = static_cast<dlimb_t>(w[i]) * b.w[j] + t[i + j] + carry;
+                t[i + j] = static_cast<limb_t>(p);
+                carry = static_cast<limb_t>(p >> limb_bits);
+            }
+        }
+        for (size_t i = 0; i < limbs; ++i)
+            w[i] = t[i];
+        return *this;
+    }
+
+    BRIGHT_CONSTEXPR FixedBigInt& operator/=(const FixedBigInt &b)
+    {
+        return *this = divmod(*this, b).first;
+    }
+
+    BRIGHT_CONSTEXPR FixedBigInt& operator%=(const FixedBigInt &b)
+    {
+        return *this = divmod(*this, b).second;
+    }
+
+    BRIGHT_CONSTEXPR FixedBigInt& operator<<=(unsigned int n)
+    {
+        size_t ls = n / limb_bits;
+        unsigned int bs = n % limb_bits;
+        for (size_t i = limbs; i-- > 0; ) {
+            limb_t hi = n < Bits && i >= ls ? w[i - ls] : 0;
+            limb_t lo = n < Bits && i >= ls + 1 ? w[i - ls - 1] : 0;
+            w[i] = bs ? (hi << bs) | (lo >> (limb_bits - bs)) : hi;
+        }
+        return *this;
+    }
+
+    BRIGHT_CONSTEXPR FixedBigInt& operator>>=(unsigned int n)
+    {
+        size_t ls = n / limb_bits;
+        unsigned int bs = n % limb_bits;
+        for (size_t i = 0; i < limbs; ++i) {
+            limb_t lo = n < Bits && i + ls < limbs ? w[i + ls] : 0;
+            limb_t hi = n < Bits && i + ls + 1 < limbs ? w[i + ls + 1] : 0;
+            w[i] = bs ? (lo >> bs) | (hi << (limb_bits - bs)) : lo;
+        }
+        return *this;
+    }
+
+    BRIGHT_CONSTEXPR FixedBigInt& operator&=(const FixedBigInt &b)
+    {
+        for (size_t i = 0; i < limbs; ++i) w[i] &= b.w[i];
+        return *this;
+    }
+
+    BRIGHT_CONSTEXPR FixedBigInt& operator|=(const FixedBigInt &b)
+    {
+        for (size_t i = 0; i < limbs; ++i) w[i] |= b.w[i];
+        return *this;
+    }
+
+    BRIGHT_CONSTEXPR FixedBigInt& operator^=(const FixedBigInt &b)
+    {
+        for (size_t i = 0; i < limbs; ++i) w[i] ^= b.w[i];
+        return *this;
+    }
+
+    BRIGHT_CONSTEXPR FixedBigInt operator~() const
+    {
+        FixedBigInt r;
+        for (size_t i = 0; i < limbs; ++i) r.w[i] = ~w[i];
+        return r;
+    }
+
+    // 2^Bits - x
+    BRIGHT_CONSTEXPR FixedBigInt operator-() const
+    {
+        return FixedBigInt() - *this;
+    }
+
+    BRIGHT_CONSTEXPR FixedBigInt& operator++()
+    {
+        return *this += FixedBigInt(1);
+    }
+
+    BRIGHT_CONSTEXPR FixedBigInt& operator--()
+    {
+        return *this -= FixedBigInt(1);
+    }
+
+    friend BRIGHT_CONSTEXPR FixedBigInt operator+(FixedBigInt a, const FixedBigInt &b) { return a += b; }
+    friend BRIGHT_CONSTEXPR FixedBigInt operator-(FixedBigInt a, const FixedBigInt &b) { return a -= b; }
+    friend BRIGHT_CONSTEXPR FixedBigInt operator*(FixedBigInt a, const FixedBigInt &b) { return a *= b; }
+    friend BRIGHT_CONSTEXPR FixedBigInt operator/(FixedBigInt a, const FixedBigInt &b) { return a /= b; }
+    friend BRIGHT_CONSTEXPR FixedBigInt operator%(FixedBigInt a, const FixedBigInt &b) { return a %= b; }
+    friend BRIGHT_CONSTEXPR FixedBigInt operator&(FixedBigInt a, const FixedBigInt &b) { return a &= b; }
+    friend BRIGHT_CONSTEXPR FixedBigInt operator|(FixedBigInt a, const FixedBigInt &b) { return a |= b; }
+    friend BRIGHT_CONSTEXPR FixedBigInt operator^(FixedBigInt a, const FixedBigInt &b) { return a ^= b; }
+    friend BRIGHT_CONSTEXPR FixedBigInt operator<<(FixedBigInt a, unsigned int n) { return a <<= n; }
+    friend BRIGHT_CONSTEXPR FixedBigInt operator>>(FixedBigInt a, unsigned int n) { return a >>= n; }
+
+    friend BRIGHT_CONSTEXPR bool operator==(const FixedBigInt &a, const FixedBigInt &b) { return compare(a, b) == 0; }
+    friend BRIGHT_CONSTEXPR bool operator!=(const FixedBigInt &a, const FixedBigInt &b) { return compare(a, b) != 0; }
+    friend BRIGHT_CONSTEXPR bool operator<(const FixedBigInt &a, const FixedBigInt &b) { return compare(a, b) < 0; }
+    friend BRIGHT_CONSTEXPR bool operator>(const FixedBigInt &a, const FixedBigInt &b) { return compare(a, b) > 0; }
+    friend BRIGHT_CONSTEXPR bool operator<=(const FixedBigInt &a, const FixedBigInt &b) { return compare(a, b) <= 0; }
+    friend BRIGHT_CONSTEXPR bool operator>=(const FixedBigInt &a, const FixedBigInt &b) { return compare(a, b) >= 0; }
+
+    // r = a + b mod 2^Bits, true when the sum did not fit; r may alias a or b
+    friend BRIGHT_CONSTEXPR bool addOverflow(const FixedBigInt &a, const FixedBigInt &b, FixedBigInt &r)
+    {
+        limb_t carry = 0;
+        for (size_t i = 0; i < limbs; ++i) {
+            limb_t x = a.w[i], y = b.w[i];
+            limb_t s = x + y;
+            limb_t c = s < x;
+            s += carry;
+            c += s < carry;
+            r.w[i] = s;
+            carry = c;
+        }
+        return carry != 0;
+    }
+
+    // r = a - b mod 2^Bits, true when b > a
+    friend BRIGHT_CONSTEXPR bool subOverflow(const FixedBigInt &a, const FixedBigInt &b, FixedBigInt &r)
+    {
+        limb_t borrow = 0;
+        for (size_t i = 0; i < limbs; ++i) {
+            limb_t x = a.w[i], y = b.w[i];
+            limb_t d = x - y;
+            limb_t c = x < y;
+            c += d < borrow;
+            r.w[i] = d - borrow;
+            borrow = c;
+        }
+        return borrow != 0;
+    }
+
+    // r = a * b mod 2^Bits, true when the full product needs more than Bits bits
+    friend BRIGHT_CONSTEXPR bool mulOverflow(const FixedBigInt &a, const FixedBigInt &b, FixedBigInt &r)
+    {
+        limb_t t[2 * limbs] = {};
+        for (size_t i = 0; i < limbs; ++i) {
+            limb_t carry = 0;
+            for (size_t j = 0; j < limbs; ++j) {
+                dlimb_t p = static_cast<dlimb_t>(a.w[i]) * b.w[j] + t[i + j] + carry;
+                t[i + j] = static_cast<limb_t>(p);
+                carry = static_cast<limb_t>(p >> limb_bits);
+            }
+            t[i + limbs] = carry;
+        }
+        limb_t high = 0;
+        for (size_t i = 0; i < limbs; ++i) {
+            r.w[i] = t[i];
+            high |= t[i + limbs];
+        }
+        return high != 0;
+    }
+
+    // the checked variants throw std::overflow_error instead of wrapping
+    friend BRIGHT_CONSTEXPR FixedBigInt checkedAdd(const FixedBigInt &a, const FixedBigInt &b)
+    {
+        FixedBigInt r;
+        if (addOverflow(a, b, r)) throw std::overflow_error("FixedBigInt addition overflow");
+        return r;
+    }
+
+    friend BRIGHT_CONSTEXPR FixedBigInt checkedSub(const FixedBigInt &a, const FixedBigInt &b)
+    {
+        FixedBigInt r;
+        if (subOverflow(a, b, r)) throw std::overflow_error("FixedBigInt subtraction overflow");
+        return r;
+    }
+
+    friend BRIGHT_CONSTEXPR FixedBigInt checkedMul(const FixedBigInt &a, const FixedBigInt &b)
+    {
+        FixedBigInt r;
+        if (mulOverflow(a, b, r)) throw std::overflow_error("FixedBigInt multiplication overflow");
+        return r;
+    }
+
+    // Knuth's Algorithm D on the fixed arrays
+    friend BRIGHT_CONSTEXPR std::pair<FixedBigInt, FixedBigInt> divmod(const FixedBigInt &a, const FixedBigInt &b)
+    {
+        size_t n = limbs, m = limbs;
+        while (n && !b.w[n - 1]) --n;
+        if (!n) throw std::invalid_argument("division by zero");
+        while (m && !a.w[m - 1]) --m;
+        FixedBigInt q, r;
+        if (m < n) {
+            r = a;
+            return std::pair<FixedBigInt, FixedBigInt>(q, r);
+        }
+        if (n == 1) {
+            limb_t d = b.w[0], rem = 0;
+            for (size_t i = m; i-- > 0; ) {
+                dlimb_t cur = (static_cast<dlimb_t>(rem) << limb_bits) | a.w[i];
+                q.w[i] = static_cast<limb_t>(cur / d);
+                rem = static_cast<limb_t>(cur % d);
+            }
+            r.w[0] = rem;
+            return std::pair<FixedBigInt, FixedBigInt>(q, r);
+        }
+
+        // normalize so the top limb of the divisor has its high bit set
+        unsigned int s = leadingZeros(b.w[n - 1]);
+        limb_t vn[limbs] = {}, un[limbs + 1] = {};
+        for (size_t i = n; i-- > 0; )
+            vn[i] = (b.w[i] << s) | (s && i ? b.w[i - 1] >> (limb_bits - s) : 0);
+        un[m] = s ? a.w[m - 1] >> (limb_bits - s) : 0;
+        for (size_t i = m; i-- > 0; )
+            un[i] = (a.w[i] << s) | (s && i ? a.w[i - 1] >> (limb_bits - s) : 0);
+
+        const dlimb_t base = static_cast<dlimb_t>(1) << limb_bits;
+        for (size_t j = m - n + 1; j-- > 0; ) {
+            dlimb_t num = (static_cast<dlimb_t>(un[j + n]) << limb_bits) | un[j + n - 1];
+            dlimb_t qhat = num / vn[n - 1], rhat = num % vn[n - 1];
+            while (qhat >= base || qhat * vn[n - 2] > ((rhat << limb_bits) | un[j + n - 2])) {
+                --qhat;
+                rhat += vn[n - 1];
+                if (rhat >= base) break;
+            }
+            limb_t borrow = 0, carry = 0;
+            for (size_t i = 0; i < n; ++i) {
+                dlimb_t p = qhat * vn[i] + carry;
+                carry = static_cast<limb_t>(p >> limb_bits);
+                limb_t x = un[i + j], y = static_cast<limb_t>(p);
+                limb_t d = x - y;
+                limb_t c = x < y;
+                c += d < borrow;
+                un[i + j] = d - borrow;
+                borrow = c;
+            }
+            limb_t top = un[j + n];
+            un[j + n] = top - carry - borrow;
+            if (top < carry || top - carry < borrow) {
+                // qhat was one too large, add the divisor back
+                --qhat;
+                limb_t c = 0;
+                for (size_t i = 0; i < n; ++i) {
+                    dlimb_t t = static_cast<dlimb_t>(un[i + j]) + vn[i] + c;
+                    un[i + j] = static_cast<limb_t>(t);
+                    c = static_cast<limb_t>(t >> limb_bits);
+                }
+                un[j + n] += c;
+            }
+            q.w[j] = static_cast<limb_t>(qhat);
+        }
+        for (size_t i = 0; i < n; ++i)
+            r.w[i] = (un[i] >> s) | (s ? un[i + 1] << (limb_bits - s) : 0);
+        return std::pair<FixedBigInt, FixedBigInt>(q, r);
+    }
+
+    friend ostream &operator<<(ostream &os, const FixedBigInt &x)
+    {
+        return os << x.toBigInt();
+    }
+};
+
 // modify classname here:
 typedef BigInt Bright;
+template <unsigned int Bits> using FixedBright = FixedBigInt<Bits>;
 
 class ErrorType {
 public:
@@ -0,0 +1,447 @@
+
+/*
+ * Bright regression tests, build and run with `make test`. Each check
+ * aborts with its line number on failure.
+ */
+
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include "bright.h"
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        std::cerr << __FILE__ << ':' << __LINE__ << ": CHECK(" #cond ") failed" << std::endl; \
+        std::abort(); \
+    } \
+} while (0)
+
+namespace {
+
+#if __cplusplus >= 201402L
+// FixedBright is constexpr from C++14 on; `make test` also compiles this
+// file as C++14 so these are checked
+constexpr FixedBright<256> fixedConstexprValue()
+{
+    FixedBright<256> x = 1;
+    x <<= 200;
+    x = x * 3 + 7;
+    x /= 5;
+    return x % 1000000007;
+}
+static_assert(fixedConstexprValue() != 0, "constexpr arithmetic");
+static_assert(FixedBright<128>(-1) + 1 == 0, "constexpr wraparound");
+static_assert((FixedBright<128>(5) << 127 >> 127) == 1, "constexpr shifts");
+static_assert(FixedBright<192>(7) * FixedBright<192>(6) - 2 == 40, "constexpr mul and sub");
+#endif
+
+std::mt19937_64 rng(20240601);
+
+// n limbs of random bits, the top one non-zero
+Bright randomLimbs(size_t n)
+{
+    vector<unsigned char> bytes(n * Bright::limb_bits / 8);
+    for (unsigned char &c : bytes)
+        c = static_cast<unsigned char>(rng());
+    if (!bytes.empty())
+        bytes.back() |= 0x80;
+    return Bright::fromBytes(bytes.data(), bytes.size(), 1, -1, -1);
+}
+
+// n limbs with every bit set
+Bright allOnes(size_t n)
+{
+    return (Bright(1) << (n * Bright::limb_bits)) - 1;
+}
+
+// a * b with the NTT and again with it switched off
+void checkNttProduct(const Bright &a, const Bright &b)
+{
+    size_t threshold = Bright::nttThreshold;
+    Bright::nttThreshold = 1;
+    Bright ntt = a * b;
+    Bright::nttThreshold = static_cast<size_t>(-1);
+    Bright toom = a * b;
+    Bright::nttThreshold = threshold;
+    CHECK(ntt == toom);
+}
+
+// the cached powers of ten built while an arena is in scope must not live in
+// it, conversions after the arena is gone still use them
+void testPow10CacheOutlivesArena()
+{
+    string digits(20000, '7');
+    {
+        Bright::Arena arena;
+        {
+            Bright::ResourceScope scope(arena);
+            Bright x(digits);
+            CHECK(x.toStr(10) == digits);
+        }
+        arena.release();
+    }
+    Bright y(digits + "1");
+    CHECK(y.toStr(10) == digits + "1");
+    CHECK(Bright::fromStr(digits, 10).toStr(10) == digits);
+}
+
+// pooled tasks allocate from new/delete even when the thread that picks them
+// up is waiting on its own group, so a Pool in scope stays on its owning
+// thread; a race here shows up under -fsanitize=thread
+void testPoolScopeWithThreads()
+{
+    unsigned int threads = Bright::threads;
+    Bright::threads = 4;
+    vector<Bright> xs;
+    for (int i = 0; i < 4000; ++i)
+        xs.push_back((Bright(i + 1) << 500) + 1);
+    Bright expected = 1;
+    for (const Bright &x : xs)
+        expected *= x;
+    for (int round = 0; round < 5; ++round) {
+        Bright::Pool pool;
+        Bright::ResourceScope scope(pool);
+        Bright p = product(xs);
+        CHECK(p == expected);
+    }
+    Bright::threads = threads;
+}
+
+// hex and octal stream input pack digit words in place, check them against
+// fromStr with leading zeros, signs and text after the number
+void testStreamInputBase2k()
+{
+    for (int i = 0; i < 2000; ++i) {
+        int base = i & 1 ? 16 : 8;
+        string digits = string(rng() % 3, '0');
+        for (size_t n = rng() % 300 + 1; n; --n)
+            digits += "0123456789abcdef"[rng() % base];
+        bool negative = i & 2;
+        std::istringstream is((negative ? "-" : "") + digits + " tail");
+        Bright x;
+        is >> (base == 16 ? std::hex : std::oct) >> x;
+        Bright expected = Bright::fromStr(digits, base);
+        CHECK(x == (negative ? -expected : expected));
+        string rest;
+        is >> rest;
+        CHECK(rest == "tail");
+    }
+}
+
+// the three-prime NTT against Toom-3/schoolbook: many small random sizes
+// with the threshold forced down, all-ones limbs for the largest carries,
+// sizes just above the default threshold, and a square at the digit limit
+void testNttProducts()
+{
+    for (int i = 0; i < 200; ++i) {
+        size_t an = rng() % 300 + 1, bn = rng() % 300 + 1;
+        checkNttProduct(randomLimbs(an), randomLimbs(bn));
+        checkNttProduct(-randomLimbs(an), randomLimbs(an));
+    }
+    for (size_t n : { 1, 2, 3, 17, 256, 1000 }) {
+        checkNttProduct(allOnes(n), allOnes(n));
+        checkNttProduct(allOnes(n), allOnes(n + 5));
+    }
+    size_t t = Bright::nttThreshold;
+    checkNttProduct(randomLimbs(t), randomLimbs(t + 1));
+    checkNttProduct(allOnes(t + 100), allOnes(t + 3));
+
+    // 2^26 32-bit digits in the result, the longest transform the primes
+    // allow; (B^k + c)^2 has a closed form to check against
+    size_t k = (static_cast<size_t>(1) << 26) / (2 * (Bright::limb_bits / 32)) - 1;
+    Bright c = randomLimbs(2);
+    Bright x = (Bright(1) << (k * Bright::limb_bits)) + c;
+    CHECK(x * x == (Bright(1) << (2 * k * Bright::limb_bits)) + ((c * 2) << (k * Bright::limb_bits)) + c * c);
+}
+
+// q * b + r == a with q truncated toward zero: r is 0 or has the sign of
+// a, |r| < |b|; the same as Knuth's Algorithm D gives
+void checkDivmod(const Bright &a, const Bright &b)
+{
+    std::pair<Bright, Bright> qr = divmod(a, b);
+    CHECK(qr.first * b + qr.second == a);
+    CHECK(qr.second.abs() < b.abs());
+    CHECK(qr.second == 0 || (qr.second < 0) == (a < 0));
+    size_t threshold = Bright::divThreshold;
+    Bright::divThreshold = static_cast<size_t>(-1);
+    std::pair<Bright, Bright> basecase = divmod(a, b);
+    Bright::divThreshold = threshold;
+    CHECK(qr == basecase);
+}
+
+// Burnikel-Ziegler above divThreshold: random sizes, every sign combination,
+// divisors whose top limb is 1 (the largest normalization shift) and
+// dividends of all-ones limbs
+void testDivmodRecursive()
+{
+    size_t t = Bright::divThreshold;
+    for (int i = 0; i < 60; ++i) {
+        size_t bn = t + 1 + rng() % (3 * t), an = bn + t + 1 + rng() % (4 * t);
+        Bright a = randomLimbs(an), b = randomLimbs(bn);
+        checkDivmod(a, b);
+        checkDivmod(-a, b);
+        checkDivmod(a, -b);
+        checkDivmod(-a, -b);
+        Bright top = (Bright(1) << ((bn - 1) * Bright::limb_bits)) + randomLimbs(bn - 2);
+        checkDivmod(a, top);
+        checkDivmod(-allOnes(an), top);
+        checkDivmod(allOnes(an), allOnes(bn));
+        // exact quotients leave r == 0
+        checkDivmod(a * b, b);
+    }
+}
+
+// values on both sides of the old 2^30 digit, a 32-bit limb and a 64-bit
+// limb survive every conversion and agree with plain integer arithmetic
+void testLimbBoundaries()
+{
+    for (unsigned int bits : { 30, 32, 60, 64, 90, 96, 128 }) {
+        Bright p = Bright(1) << bits;
+        for (Bright x : { p - 1, p, p + 1, -(p - 1), -p }) {
+            for (int base : { 2, 8, 10, 16 })
+                CHECK(Bright::fromStr(x.toStr(base), base) == x);
+            vector<unsigned char> bytes(x.toBytes(nullptr, 1, 1, 1));
+            x.toBytes(bytes.data(), 1, 1, 1);
+            CHECK(Bright::fromBytes(bytes.data(), bytes.size(), 1, 1, 1) == x.abs());
+            CHECK(x.size() == (x.abs() >= p ? bits + 1 : bits));
+            CHECK((x + 1) - 1 == x);
+            CHECK((x * x) / x == x);
+        }
+        CHECK((p - 1) + 1 == p);
+        CHECK(p - 1 - p == -1);
+        CHECK((p - 1) * (p - 1) == (p << bits) - (p << 1) + 1);
+        CHECK(divmod((p << bits) - 1, p + 1) == std::make_pair(p - 1, Bright(0)));
+    }
+    CHECK(Bright(1) << 32 == Bright(4294967296LL));
+    CHECK(Bright((1LL << 62) + 12345) * 4 == Bright("18446744073709600996"));
+    CHECK(Bright(-9223372036854775807LL - 1).toStr(10) == "-9223372036854775808");
+    CHECK(Bright("18446744073709551615") + 1 == Bright("18446744073709551616"));
+    CHECK(Bright("18446744073709551616") % 4294967291LL == 25);
+}
+
+// shift() and unshift() keep working in 2^30 digits whatever the limb width
+void testShiftUnshiftDigits()
+{
+    Bright x;
+    x.unshift(Bright::mask).unshift(5).unshift(Bright::base + 7);
+    CHECK(x == (Bright(Bright::mask) << 60) + (Bright(5) << 30) + 7);
+    CHECK(x.shift() == 7);
+    CHECK(x.shift() == 5);
+    CHECK(x.shift() == Bright::mask);
+    CHECK(x == 0);
+    CHECK(x.shift() == 0);
+
+    Bright y = randomLimbs(9), z = y;
+    vector<unsigned long long> digits;
+    while (z != 0)
+        digits.push_back(z.shift());
+    CHECK(Bright(digits) == y);
+    for (size_t i = digits.size(); i-- > 0; )
+        z.unshift(static_cast<unsigned int>(digits[i]));
+    CHECK(z == y);
+}
+
+// a random value of up to 4 limbs, either sign
+Bright randomSigned()
+{
+    Bright x = randomLimbs(rng() % 5) >> static_cast<unsigned int>(rng() % Bright::limb_bits);
+    return rng() & 1 ? -x : x;
+}
+
+// floor(x / 2^k) through truncating division
+Bright floorShift(const Bright &x, unsigned int k)
+{
+    std::pair<Bright, Bright> qr = divmod(x, Bright(1) << k);
+    return qr.second < 0 ? qr.first - 1 : qr.first;
+}
+
+// << and >> shift by bits, >> rounds toward -infinity; & | ^ ~ and testBit
+// see negative values as two's complement, checked bit by bit and against
+// the built-in integers
+void testBitOperations()
+{
+    CHECK((Bright(1) << 9) == 512);
+    CHECK((Bright(-7) >> 1) == -4);
+    CHECK((Bright(-1) >> 100) == -1);
+    CHECK((Bright(-8) >> 3) == -1);
+    CHECK((Bright(-9) >> 3) == -2);
+    for (int i = 0; i < 2000; ++i) {
+        long long a = static_cast<long long>(rng() >> 2) * (rng() & 1 ? -1 : 1);
+        long long b = static_cast<long long>(rng() >> 33) * (rng() & 1 ? -1 : 1);
+        unsigned int k = static_cast<unsigned int>(rng() % 62);
+        CHECK((Bright(a) >> k) == (a >> k));
+        CHECK((Bright(a) & Bright(b)) == (a & b));
+        CHECK((Bright(a) | Bright(b)) == (a | b));
+        CHECK((Bright(a) ^ Bright(b)) == (a ^ b));
+        CHECK(~Bright(a) == ~a);
+        CHECK(Bright(a).testBit(k) == (((a >> k) & 1) != 0));
+        CHECK(Bright(a).testBit(200) == (a < 0));
+    }
+    for (int i = 0; i < 500; ++i) {
+        Bright a = randomSigned(), b = randomSigned();
+        unsigned int k = static_cast<unsigned int>(rng() % 300);
+        CHECK((a >> k) == floorShift(a, k));
+        CHECK((a << k) == a * (Bright(1) << k));
+        CHECK(~a == -a - 1);
+        Bright andAB = a & b, orAB = a | b, xorAB = a ^ b;
+        for (size_t j = 0; j < 300; ++j) {
+            bool x = a.testBit(j), y = b.testBit(j);
+            CHECK(andAB.testBit(j) == (x && y));
+            CHECK(orAB.testBit(j) == (x || y));
+            CHECK(xorAB.testBit(j) == (x != y));
+        }
+        Bright c = a;
+        bool was = c.testBit(k);
+        c.setBit(k, !was);
+        CHECK(c == (was ? a - (Bright(1) << k) : a + (Bright(1) << k)));
+        CHECK(c.testBit(k) == !was);
+        c.setBit(k, was);
+        CHECK(c == a);
+        if (a != 0) {
+            size_t t = a.countTrailingZeros();
+            CHECK(((a << k).countTrailingZeros()) == t + k);
+            CHECK(a.testBit(t) && (a >> static_cast<unsigned int>(t)).testBit(0));
+            CHECK((-a).countTrailingZeros() == t);
+        }
+    }
+    CHECK(Bright(0).countTrailingZeros() == 0);
+}
+
+// gcd is non-negative and divides both, gcdext meets Bezout's identity,
+// lcm * gcd == |a * b|, modinv inverts or throws; zero and negative
+// arguments in every position
+void testGcdFamily()
+{
+    CHECK(gcd(Bright(0), Bright(0)) == 0);
+    CHECK(gcd(Bright(0), Bright(-12)) == 12);
+    CHECK(gcd(Bright(-18), Bright(12)) == 6);
+    CHECK(lcm(Bright(0), Bright(5)) == 0);
+    CHECK(lcm(Bright(-4), Bright(6)) == 12);
+    CHECK(modinv(Bright(3), Bright(7)) == 5);
+    CHECK(modinv(Bright(-3), Bright(7)) == 2);
+    CHECK(modinv(Bright(3), Bright(-7)) == 5);
+
+    for (int i = 0; i < 300; ++i) {
+        Bright common = randomLimbs(rng() % 3);
+        Bright a = randomSigned() * common, b = randomSigned() * common;
+        if (i % 10 == 0) a = 0;
+        Bright g = gcd(a, b), s, t;
+        CHECK(g >= 0);
+        CHECK(gcdext(a, b, s, t) == g);
+        CHECK(a * s + b * t == g);
+        if (g == 0) {
+            CHECK(a == 0 && b == 0);
+            continue;
+        }
+        CHECK(a % g == 0 && b % g == 0);
+        CHECK(gcd(a / g, b / g) == 1);
+        CHECK(lcm(a, b) * g == (a * b).abs());
+
+        Bright m = b.abs() + 2;
+        if (gcd(a, m) == 1) {
+            Bright inv = modinv(a, m);
+            CHECK(inv >= 0 && inv < m);
+            Bright one = a * inv % m;
+            CHECK(one == 1 || one == Bright(1) - m);
+        }
+    }
+
+    bool threw = false;
+    try {
+        modinv(Bright(6), Bright(9));
+    } catch (const std::invalid_argument &) {
+        threw = true;
+    }
+    CHECK(threw);
+    threw = false;
+    try {
+        modinv(Bright(0), Bright(7));
+    } catch (const std::invalid_argument &) {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+// FixedBright wraps modulo 2^Bits, the checked variants throw instead,
+// and conversions from Bright take negative values as two's complement
+void testFixedBright()
+{
+    typedef FixedBright<256> F;
+    Bright m = Bright(1) << 256;
+    F max = ~F();
+    CHECK(max + 1 == F());
+    CHECK(F() - 1 == max);
+    CHECK(-F(1) == max);
+    CHECK(max * max == 1);
+    CHECK((F(1) << 256) == F());
+    CHECK(F(-5LL).toBigInt() == m - 5);
+    CHECK(F(Bright(-5)) == F(-5LL));
+    CHECK(F(m + 3) == 3);
+    CHECK(F(-m - 3).toBigInt() == m - 3);
+
+    F r;
+    CHECK(addOverflow(max, F(1), r) && r == F());
+    CHECK(!addOverflow(max, F(), r) && r == max);
+    CHECK(subOverflow(F(), F(1), r) && r == max);
+    CHECK(mulOverflow(F(1) << 128, F(1) << 128, r) && r == F());
+    CHECK(!mulOverflow(F(1) << 127, F(1) << 128, r) && r == F(1) << 255);
+
+    int thrown = 0;
+    try { checkedAdd(max, F(1)); } catch (const std::overflow_error &) { ++thrown; }
+    try { checkedSub(F(1), F(2)); } catch (const std::overflow_error &) { ++thrown; }
+    try { checkedMul(max, F(2)); } catch (const std::overflow_error &) { ++thrown; }
+    try { F(1) / F(); } catch (const std::invalid_argument &) { ++thrown; }
+    CHECK(thrown == 4);
+    CHECK(checkedAdd(F(2), F(3)) == 5 && checkedSub(F(3), F(2)) == 1 && checkedMul(F(4), F(5)) == 20);
+
+    for (int i = 0; i < 500; ++i) {
+        Bright a = randomSigned() << static_cast<unsigned int>(rng() % 200);
+        Bright b = randomSigned();
+        F x(a), y(b);
+        Bright ua = (a % m + m) % m, ub = (b % m + m) % m;
+        CHECK(x.toBigInt() == ua);
+        CHECK((x + y).toBigInt() == (ua + ub) % m);
+        CHECK((x - y).toBigInt() == ((ua - ub) % m + m) % m);
+        CHECK((x * y).toBigInt() == ua * ub % m);
+        if (y) {
+            CHECK((x / y).toBigInt() == ua / ub);
+            CHECK((x % y).toBigInt() == ua % ub);
+        }
+        CHECK((x < y) == (ua < ub));
+    }
+}
+
+// only bases 2, 8, 10 and 16 convert, others throw rather than fall back
+// to hex
+void testUnsupportedBases()
+{
+    for (int base : { 0, 1, 3, 7, 9, 12, 36, -10 }) {
+        int thrown = 0;
+        try { Bright::fromStr("777", base); } catch (const std::invalid_argument &) { ++thrown; }
+        try { Bright(12345).toStr(base); } catch (const std::invalid_argument &) { ++thrown; }
+        try { Bright(0).toStr(base); } catch (const std::invalid_argument &) { ++thrown; }
+        try { Bright("777", base); } catch (const std::invalid_argument &) { ++thrown; }
+        CHECK(thrown == 4);
+    }
+    CHECK(Bright::fromStr("777", 8) == 511);
+    CHECK(Bright(511).toStr(8) == "777");
+}
+
+} // namespace
+
+int main()
+{
+    testPow10CacheOutlivesArena();
+    testPoolScopeWithThreads();
+    testStreamInputBase2k();
+    testNttProducts();
+    testDivmodRecursive();
+    testLimbBoundaries();
+    testShiftUnshiftDigits();
+    testBitOperations();
+    testGcdFamily();
+    testFixedBright();
+    testUnsupportedBases();
+    std::cout << "all tests passed" << std::endl;
+    return 0;
+}